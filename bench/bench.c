@@ -0,0 +1,84 @@
+#include "bench.h"
+
+/* Private function prototypes -----------------------------------------------*/
+static void bench_run_kernel(const Bench_Kernel_t *kernel);
+static void bench_sort(float *values, uint32_t count);
+
+
+/**
+ * @brief Run every kernel and print the results as CSV
+ * @note Format (version BENCH_FORMAT_VERSION), values are per call:
+ *   platform,kernel,size,unit,batch,batches,min,median,mean
+ * Lines starting with '#' are comments
+ */
+void bench_run_all(void) {
+    printf("# wlm-bench format %d\n", BENCH_FORMAT_VERSION);
+    printf("platform,kernel,size,unit,batch,batches,min,median,mean\n");
+
+    for (size_t i = 0; i < bench_kernel_count; i++) {
+        bench_run_kernel(&bench_kernels[i]);
+    }
+    fflush(stdout);
+}
+
+/**
+ * @brief Time one kernel in batches and print its row
+ * @param kernel Kernel to run
+ * @note The minimum is the most stable figure for regression tracking, the
+ * median and mean show how much interrupts and caches disturb it
+ */
+static void bench_run_kernel(const Bench_Kernel_t *kernel) {
+    float per_call[BENCH_BATCHES];
+    uint32_t iteration = 0;
+    double sum = 0;
+
+    if (NULL != kernel->setup) {
+        kernel->setup();
+    }
+
+    // Warm-up batch, not recorded
+    for (uint32_t j = 0; j < kernel->batch; j++) {
+        kernel->run(iteration++);
+    }
+
+    for (uint32_t b = 0; b < BENCH_BATCHES; b++) {
+        bench_timer_start();
+        for (uint32_t j = 0; j < kernel->batch; j++) {
+            kernel->run(iteration++);
+        }
+        uint64_t elapsed = bench_timer_stop();
+
+        per_call[b] = (float)elapsed / (float)kernel->batch;
+        sum += per_call[b];
+    }
+
+    bench_sort(per_call, BENCH_BATCHES);
+    printf("%s,%s,%lu,%s,%lu,%d,%.2f,%.2f,%.2f\n",
+        bench_platform(),
+        kernel->name,
+        (unsigned long)kernel->size,
+        bench_unit(),
+        (unsigned long)kernel->batch,
+        BENCH_BATCHES,
+        per_call[0],
+        per_call[BENCH_BATCHES / 2],
+        sum / BENCH_BATCHES);
+}
+
+/**
+ * @brief Sort batch results in place
+ * @param values Values to sort
+ * @param count Number of values
+ */
+static void bench_sort(float *values, uint32_t count) {
+    // Insertion sort, count is small
+    for (uint32_t i = 1; i < count; i++) {
+        float value = values[i];
+        int j = i - 1;
+        while (j >= 0 && values[j] > value) {
+            values[j + 1] = values[j];
+            j--;
+        }
+        values[j + 1] = value;
+    }
+}
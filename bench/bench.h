@@ -0,0 +1,46 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Output format version, bump when the columns change
+#define BENCH_FORMAT_VERSION    1
+// Timed batches per kernel, the first batch is a discarded warm-up
+#define BENCH_BATCHES           31
+
+/**
+ * @brief Benchmark kernel definition
+ */
+typedef struct {
+    const char *name;               // Kernel name, unique and stable across versions
+    uint32_t size;                  // Bytes (or records) processed per call, 0 if not applicable
+    uint32_t batch;                 // Calls per timed batch
+    void (*setup)(void);            // Called once before the kernel is timed, may be NULL
+    void (*run)(uint32_t iteration);
+} Bench_Kernel_t;
+
+/**
+ * @brief Benchmark function protoypes
+ */
+// Kernel table, see bench_kernels.c
+extern const Bench_Kernel_t bench_kernels[];
+extern const size_t bench_kernel_count;
+// Run every kernel and print one CSV row each
+void bench_run_all(void);
+
+/**
+ * @brief Platform hooks, see bench_host.c and bench_pico.c
+ */
+// Start the batch timer
+void bench_timer_start(void);
+// Elapsed time since bench_timer_start() in platform units
+uint64_t bench_timer_stop(void);
+// Platform name for the CSV rows
+const char *bench_platform(void);
+// Unit of bench_timer_stop(), e.g. "ns" or "cycles"
+const char *bench_unit(void);
+
+#endif /* BENCH_H */
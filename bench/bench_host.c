@@ -0,0 +1,44 @@
+/**
+ * @brief Host (Linux) entry point of the microbenchmarks, times in nanoseconds
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include "bench.h"
+
+/* Private variables ---------------------------------------------------------*/
+static uint64_t start_ns;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint64_t now_ns(void);
+
+
+int main(void) {
+    bench_run_all();
+    return 0;
+}
+
+void bench_timer_start(void) {
+    start_ns = now_ns();
+}
+
+uint64_t bench_timer_stop(void) {
+    return now_ns() - start_ns;
+}
+
+const char *bench_platform(void) {
+    return "host";
+}
+
+const char *bench_unit(void) {
+    return "ns";
+}
+
+/**
+ * @brief Monotonic time in nanoseconds
+ * @return Nanoseconds since an arbitrary epoch
+ */
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
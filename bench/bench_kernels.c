@@ -0,0 +1,166 @@
+#include "bench.h"
+#include "config.h"
+#include "stats.h"
+#include "trace.h"
+#include "lineproto.h"
+#include "sensors_conv.h"
+#if BENCH_HAVE_LWIP
+#include "echo.h"
+#endif
+
+// Largest echo request and its reply including the IP header
+#define BENCH_ECHO_MIN_LEN      ((uint16_t)sizeof(ICMP_EchoHeader_t))
+#define BENCH_ECHO_MAX_LEN      ((uint16_t)(sizeof(ICMP_EchoHeader_t) + PING_PROBE_MAX_PAYLOAD))
+#define BENCH_IP_HLEN           20
+
+/* Private variables ---------------------------------------------------------*/
+// Results are written here so the kernels are not optimized away
+static volatile uint32_t bench_sink;
+static Stats_Summary_t summary;
+static Stats_Window_t window;
+static uint64_t window_now_us;
+static uint8_t trace_block[TRACE_BLOCK_BYTES];
+static Influx_Measurement_t meas;
+static char line[384];
+#if BENCH_HAVE_LWIP
+static uint8_t echo_request[sizeof(ICMP_EchoHeader_t) + PING_PROBE_MAX_PAYLOAD];
+static uint8_t echo_reply[BENCH_IP_HLEN + sizeof(ICMP_EchoHeader_t) + PING_PROBE_MAX_PAYLOAD];
+#endif
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t rtt_sample(uint32_t iteration);
+
+
+/**
+ * @brief Deterministic RTT spread over the histogram bins
+ * @param iteration Call number
+ * @return RTT in microseconds
+ */
+static uint32_t rtt_sample(uint32_t iteration) {
+    return 300 + ((iteration * 2654435761u) >> 12) % 60000;
+}
+
+static void stats_setup(void) {
+    stats_reset(&summary);
+    for (uint32_t i = 0; i < 1000; i++) {
+        stats_add(&summary, rtt_sample(i));
+    }
+}
+
+static void bench_stats_add(uint32_t iteration) {
+    stats_add(&summary, rtt_sample(iteration));
+}
+
+static void bench_stats_percentile(uint32_t iteration) {
+    (void)iteration;
+    bench_sink = stats_percentile_us(&summary, 99);
+}
+
+static void window_setup(void) {
+    window_now_us = 0;
+    stats_window_init(&window, 10000, 6, window_now_us);
+}
+
+static void bench_stats_window_add(uint32_t iteration) {
+    // One sample per millisecond, buckets expire every 10000 calls
+    window_now_us += 1000;
+    stats_window_add(&window, window_now_us, rtt_sample(iteration));
+}
+
+static void trace_setup(void) {
+    uint64_t tx_us = 1000000;
+    for (uint16_t seq = 1; seq <= TRACE_BLOCK_RECORDS; seq++) {
+        tx_us += 5000 + (seq % 7);
+        if (0 == seq % 16) {
+            trace_record_loss(seq, tx_us);
+        } else {
+            trace_record(seq, tx_us, rtt_sample(seq));
+        }
+    }
+}
+
+static void bench_trace_encode(uint32_t iteration) {
+    (void)iteration;
+    uint16_t records;
+    bench_sink = trace_encode_block(trace_block, sizeof(trace_block), 1760000000000000ULL, true, &records);
+}
+
+static void lineproto_setup(void) {
+    meas.rtt_avg_us = 2345;
+    meas.rtt_min_us = 1234;
+    meas.rtt_max_us = 5678;
+    meas.jitter_us = 321;
+    meas.loss_pct = 0;
+    meas.temperature_c = 31.25f;
+    meas.rtt_avg_corr_us = 2105;
+    meas.rtt_min_corr_us = 1002;
+    meas.rtt_max_corr_us = 5411;
+    meas.failed = false;
+}
+
+static void bench_lineproto(uint32_t iteration) {
+    meas.rtt_avg_us = 2000 + (iteration & 0x3ff);
+    bench_sink = lineproto_format_measurements(line, sizeof(line), &meas, 1760000000000000ULL + iteration);
+}
+
+static void bench_temperature(uint32_t iteration) {
+    // TEMP_SAMPLE_COUNT samples around 27 degrees
+    float celsius = temperature_from_adc(512 * 876 + (iteration & 0xff), 512);
+    bench_sink = (uint32_t)(celsius * 100.0f);
+}
+
+#if BENCH_HAVE_LWIP
+static void echo_setup(void) {
+    uint8_t *padding = echo_request + sizeof(ICMP_EchoHeader_t);
+    for (uint16_t i = 0; i < PING_PROBE_MAX_PAYLOAD; i++) {
+        padding[i] = (uint8_t)i;
+    }
+    echo_build_request(echo_request, BENCH_ECHO_MAX_LEN, 1, 0);
+
+    // Minimal IPv4 header in front of the reply, only the header length is parsed
+    memset(echo_reply, 0, BENCH_IP_HLEN);
+    echo_reply[0] = 0x45;
+    memcpy(echo_reply + BENCH_IP_HLEN, echo_request, BENCH_ECHO_MAX_LEN);
+    ICMP_EchoHeader_t *reply = (ICMP_EchoHeader_t *)(echo_reply + BENCH_IP_HLEN);
+    reply->type = ICMP_ER;
+    reply->checksum = 0;
+    reply->checksum = inet_chksum(reply, BENCH_ECHO_MAX_LEN);
+}
+
+static void bench_chksum_min(uint32_t iteration) {
+    (void)iteration;
+    bench_sink = inet_chksum(echo_request, BENCH_ECHO_MIN_LEN);
+}
+
+static void bench_chksum_max(uint32_t iteration) {
+    (void)iteration;
+    bench_sink = inet_chksum(echo_request, BENCH_ECHO_MAX_LEN);
+}
+
+static void bench_echo_build(uint32_t iteration) {
+    echo_build_request(echo_request, BENCH_ECHO_MAX_LEN, (uint16_t)iteration, iteration);
+}
+
+static void bench_echo_parse(uint32_t iteration) {
+    (void)iteration;
+    uint16_t seq = 0;
+    bench_sink = echo_parse_reply(echo_reply, BENCH_IP_HLEN + BENCH_ECHO_MAX_LEN, &seq) + seq;
+}
+#endif
+
+const Bench_Kernel_t bench_kernels[] = {
+#if BENCH_HAVE_LWIP
+    { "chksum_echo_min",        sizeof(ICMP_EchoHeader_t),  1000, echo_setup,       bench_chksum_min },
+    { "chksum_echo_max",        BENCH_ECHO_MAX_LEN,         100,  echo_setup,       bench_chksum_max },
+    { "echo_build_max",         BENCH_ECHO_MAX_LEN,         100,  echo_setup,       bench_echo_build },
+    { "echo_parse_max",         BENCH_IP_HLEN + BENCH_ECHO_MAX_LEN, 100, echo_setup, bench_echo_parse },
+#endif
+    { "stats_add",              0,                          1000, stats_setup,      bench_stats_add },
+    { "stats_percentile_p99",   0,                          1000, stats_setup,      bench_stats_percentile },
+    { "stats_window_add",       0,                          1000, window_setup,     bench_stats_window_add },
+    { "trace_encode_block",     TRACE_BLOCK_RECORDS,        10,   trace_setup,      bench_trace_encode },
+    { "lineproto_measurement",  0,                          100,  lineproto_setup,  bench_lineproto },
+    { "temperature_from_adc",   0,                          1000, NULL,             bench_temperature },
+};
+
+const size_t bench_kernel_count = sizeof(bench_kernels) / sizeof(bench_kernels[0]);
@@ -0,0 +1,70 @@
+/**
+ * @brief Pico entry point of the microbenchmarks, times in clk_sys cycles
+ *
+ * Results are printed over USB stdio once a terminal is connected, press any
+ * key to run the suite again.
+ */
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
+#include "bench.h"
+
+// SysTick is a 24-bit down counter clocked from clk_sys
+#define SYSTICK_MAX             0x00ffffffu
+#define SYSTICK_CSR_ENABLE      0x1u
+#define SYSTICK_CSR_CLKSOURCE   0x4u
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t start_ticks;
+static uint64_t start_us;
+
+
+int main(void) {
+    stdio_init_all();
+
+    systick_hw->csr = 0;
+    systick_hw->rvr = SYSTICK_MAX;
+    systick_hw->cvr = 0;
+    systick_hw->csr = SYSTICK_CSR_ENABLE | SYSTICK_CSR_CLKSOURCE;
+
+    while (true) {
+        while (!stdio_usb_connected()) {
+            sleep_ms(100);
+        }
+        sleep_ms(500);
+
+        printf("# clk_sys_hz=%lu\n", (unsigned long)clock_get_hz(clk_sys));
+        bench_run_all();
+
+        // Wait for a key press before the next run
+        while (PICO_ERROR_TIMEOUT == getchar_timeout_us(1000000)) {
+            tight_loop_contents();
+        }
+    }
+    return 0;
+}
+
+void bench_timer_start(void) {
+    start_us = time_us_64();
+    start_ticks = systick_hw->cvr;
+}
+
+uint64_t bench_timer_stop(void) {
+    uint32_t ticks = systick_hw->cvr;
+    uint64_t elapsed_us = time_us_64() - start_us;
+    uint32_t cycles_per_us = clock_get_hz(clk_sys) / 1000000;
+
+    // SysTick wraps every 2^24 cycles, long batches fall back to the microsecond timer
+    if (elapsed_us * cycles_per_us >= SYSTICK_MAX / 2) {
+        return elapsed_us * cycles_per_us;
+    }
+    return (start_ticks - ticks) & SYSTICK_MAX;
+}
+
+const char *bench_platform(void) {
+    return "rp2040";
+}
+
+const char *bench_unit(void) {
+    return "cycles";
+}
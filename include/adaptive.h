@@ -0,0 +1,56 @@
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "config.h"
+
+/**
+ * @brief Adaptive sampling controller states
+ */
+typedef enum {
+    ADAPTIVE_STATE_NORMAL = 0,  // Baseline tracking, nominal interval
+    ADAPTIVE_STATE_ANOMALY,     // Change detected, fastest interval
+    ADAPTIVE_STATE_DECAY        // Link calm again, interval backing off
+} Adaptive_State_t;
+
+/**
+ * @brief Events reported by the controller on state changes
+ */
+typedef enum {
+    ADAPTIVE_EVENT_NONE = 0,
+    ADAPTIVE_EVENT_ONSET,       // Anomaly started
+    ADAPTIVE_EVENT_END          // Back to the nominal interval
+} Adaptive_Event_t;
+
+/**
+ * @brief Adaptive sampling handle structure definition
+ */
+typedef struct {
+    uint32_t samples;       // Samples used for the baseline
+    float rtt_mean_us;      // EWMA RTT baseline
+    float rtt_var_us2;      // EWMA RTT variance
+    float loss_mean;        // EWMA loss fraction baseline
+    float cusum_rtt;        // Upper CUSUM of normalized RTT
+    float cusum_loss;       // Upper CUSUM of loss fraction
+    float last_z;           // Normalized deviation of the last RTT sample
+    uint8_t state;          // Adaptive_State_t
+    uint32_t calm_cycles;   // Consecutive cycles without deviation
+    uint32_t anomaly_cycles;// Cycles since the anomaly started
+    uint32_t interval_ms;   // Current measurement interval
+} Adaptive_Handle_t;
+
+/**
+ * @brief Adaptive sampling function protoypes
+ */
+// Reset the controller
+void adaptive_init(Adaptive_Handle_t *handle);
+// Feed one measurement cycle and get the resulting event
+Adaptive_Event_t adaptive_update(Adaptive_Handle_t *handle, bool rtt_valid,
+                                uint64_t rtt_us, uint8_t loss_pct);
+// Interval until the next measurement cycle
+uint32_t adaptive_interval_ms(const Adaptive_Handle_t *handle);
+
+#endif /* ADAPTIVE_H */
@@ -5,6 +5,11 @@
 #define ROUTER_IP_ADDR          "192.168.2.1"
 #define WIFI_SSID               "SomeSSID"
 #define WIFI_PASSWORD           "SomePassword"
+#define NTP_SERVER_IP           "192.168.2.1"
+
+// Time synchronisation configuration, larger steps are applied without updating the drift
+#define TIMESYNC_MAX_STEP_US    100000
+#define TIMESYNC_MAX_DRIFT_PPB  500000
 
 // Measurememnt configuration
 #define PING_TIMEOUT_MS         2000
@@ -12,9 +17,92 @@
 #define MAX_RETRY_COUNT         5
 #define INITIAL_RETRY_DELAY_MS  1000
 #define MEASUREMENT_INTERVAL_MS 5000
+#define PING_CALIBRATION_COUNT  32
+#define PING_CALIBRATION_TIMEOUT_MS 100
+#define PING_TX_POOL_SIZE       4
+
+// Burst probing configuration
+#define PING_BURST_ENABLE       1
+#define PING_BURST_RATE_HZ      100
+#define PING_BURST_MAX_RATE_HZ  200
+#define PING_BURST_DURATION_MS  1000
+#define PING_BURST_TIMEOUT_MS   500
+#if LWIP_LOW_FOOTPRINT
+#define PING_BURST_MAX_INFLIGHT 8
+#else
+#define PING_BURST_MAX_INFLIGHT 16
+#endif
+#define PING_BURST_EVERY_N_CYCLES 12
+
+// Capacity probing configuration
+#define PING_CAPACITY_ENABLE    1
+#define PING_CAPACITY_EVERY_N_CYCLES 60
+#define PING_PROBE_MAX_PAYLOAD  1468
+#define PING_SWEEP_STEPS        5
+#define PING_SWEEP_PROBES       3
+#define PING_TRAIN_LENGTH       5
+#define PING_TRAIN_COUNT        3
+
+// Per access category probing configuration, DSCP per WMM AC (TOS = DSCP << 2)
+#define QOS_ENABLE              1
+#define QOS_EVERY_N_CYCLES      6
+#define QOS_PROBES_PER_CLASS    5
+#define QOS_DSCP_VO             48
+#define QOS_DSCP_VI             40
+#define QOS_DSCP_BE             0
+#define QOS_DSCP_BK             8
+
+// TCP goodput test configuration, needs tools/goodput_sink running on GOODPUT_SINK_IP
+#define GOODPUT_ENABLE          0
+#define GOODPUT_SINK_IP         "192.168.2.10"
+#define GOODPUT_SINK_PORT       5201
+#define GOODPUT_DURATION_MS     5000
+#define GOODPUT_CONNECT_TIMEOUT_MS 3000
+#define GOODPUT_EVERY_N_CYCLES  720
+
+// Adaptive sampling configuration
+#define ADAPTIVE_ENABLE         1
+#define ADAPTIVE_MIN_INTERVAL_MS 1000
+#define ADAPTIVE_DECAY_FACTOR   2
+#define ADAPTIVE_WARMUP_SAMPLES 8
+#define ADAPTIVE_EWMA_ALPHA     0.0625f
+#define ADAPTIVE_MIN_SIGMA_US   200.0f
+#define ADAPTIVE_CUSUM_K        0.5f
+#define ADAPTIVE_CUSUM_H        5.0f
+#define ADAPTIVE_CALM_Z         2.0f
+#define ADAPTIVE_LOSS_K         0.05f
+#define ADAPTIVE_LOSS_H         0.3f
+#define ADAPTIVE_CALM_CYCLES    5
+#define ADAPTIVE_MAX_ANOMALY_CYCLES 300
+
+// Per-packet trace configuration
+#define TRACE_ENABLE            1
+#define TRACE_RING_SIZE         256
+#define TRACE_BLOCK_RECORDS     64
+#define TRACE_BLOCK_BYTES       512
+
+// Sliding window aggregation configuration
+#define WINDOW_EXPORT_INTERVAL_MS 60000
+
+// Power management A/B configuration, cycles the Wi-Fi power-save profiles every window
+#define WIFI_PM_AB_ENABLE       0
+#define WIFI_PM_AB_WINDOW_CYCLES 60
+#define WIFI_PM_AB_SETTLE_CYCLES 2
+#define WIFI_PM_CUSTOM_SLEEP_RET_MS 200
+#define WIFI_PM_CUSTOM_LI_BEACON 1
+#define WIFI_PM_CUSTOM_LI_DTIM  3
+#define WIFI_PM_CUSTOM_LI_ASSOC 10
+
+// Wi-Fi connection event log configuration
+#define WIFI_CONNECT_TIMEOUT_MS 30000
+#define WIFI_EVENT_LOG_SIZE     32
+#define WIFI_EVENTS_PER_UPLOAD  8
 
 // InfluxDB configuration
 #define INFLUX_RETRY_DELAY_MS   1000
+#define INFLUX_BATCH_BUF_SIZE   1280
+#define INFLUX_BATCH_MAX_POINTS 5
+#define INFLUX_BATCH_MAX_AGE_MS 30000
 #define INFLUXDB_IP             "SomeIP"
 #define INFLUXDB_PORT           8086
 #define INFLUXDB_ORG            "Wi-Fi%20Latency"
@@ -0,0 +1,42 @@
+#ifndef ECHO_H
+#define ECHO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "lwip/def.h"
+#include "lwip/icmp.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/inet_chksum.h"
+
+// ICMP echo identifier used by all probes
+#define PING_ECHO_ID            0xBADA
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;        // ICMP type
+    uint8_t code;        // ICMP code
+    uint16_t checksum;   // ICMP checksum
+    uint16_t id;         // Identifier
+    uint16_t sequence;   // Sequence number
+    uint32_t timestamp;   // Timestamp in ms
+} ICMP_EchoHeader_t;
+
+/**
+ * @brief Echo reply classification
+ */
+typedef enum {
+    ECHO_REPLY_NOT_OURS = 0,    // Not a reply to our probes, leave it to lwIP
+    ECHO_REPLY_CORRUPT,         // Our reply, but the checksum does not match
+    ECHO_REPLY_OK
+} Echo_Reply_t;
+
+/**
+ * @brief Echo packet function protoypes
+ * @note Pure packet kernels shared by the probe path and the benchmarks
+ */
+// Write the echo request header in front of the padding and checksum the message
+void echo_build_request(uint8_t *msg, uint16_t len, uint16_t seq, uint32_t timestamp_ms);
+// Validate an echo reply starting at the IP header and extract its sequence number
+Echo_Reply_t echo_parse_reply(const uint8_t *pkt, uint16_t len, uint16_t *seq);
+
+#endif /* ECHO_H */
@@ -0,0 +1,49 @@
+#ifndef GOODPUT_H
+#define GOODPUT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/ip_addr.h"
+#include "lwip/tcp.h"
+#include "lwip/stats.h"
+#include "config.h"
+#include "ping.h"
+
+// Command byte sent to the sink after connecting, see tools/goodput_sink.c
+#define GOODPUT_CMD_UPLOAD      'U'
+#define GOODPUT_CMD_DOWNLOAD    'D'
+
+/**
+ * @brief Result of one transfer direction
+ */
+typedef struct {
+    bool ok;                    // Connected and moved data
+    uint64_t bytes;             // Payload bytes acknowledged (upload) or received (download)
+    uint32_t duration_us;       // Transfer time the bytes were counted over
+    float goodput_mbps;         // bytes * 8 / duration_us
+    int32_t retransmits;        // TCP segments retransmitted, -1 without TCP_STATS
+    uint32_t rtt_loaded_us;     // Average router RTT during the transfer, 0 if no replies
+    bool qos_ok;                // Per access category probes got a reply
+    Ping_Qos_t qos;             // Per access category RTT during the transfer
+} Goodput_Direction_t;
+
+/**
+ * @brief Goodput test result
+ */
+typedef struct {
+    uint32_t rtt_idle_us;       // Average router RTT before the test, 0 if no replies
+    Goodput_Direction_t up;
+    Goodput_Direction_t down;
+} Goodput_Result_t;
+
+/**
+ * @brief Goodput function protoypes
+ */
+// Run upload and download transfers against the sink and measure RTT under load
+bool goodput_run(Goodput_Result_t *result);
+
+#endif /* GOODPUT_H */
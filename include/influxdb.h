@@ -4,29 +4,61 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <math.h>
 #include "pico/stdlib.h"
 #include "pico/cyw43_arch.h"
 #include "lwip/ip_addr.h"
 #include "lwip/tcp.h"
 #include "lwip/pbuf.h"
 #include "config.h"
+#include "wifi.h"
+#include "timesync.h"
+#include "ping.h"
+#include "adaptive.h"
+#include "goodput.h"
+#include "lineproto.h"
 
 typedef struct {
     struct tcp_pcb *pcb;
     bool complete;
     bool success;
-    char request[1024];
+    char request[INFLUX_BATCH_BUF_SIZE + 512];
     int request_len;
 } HTTP_Handle_t;
 
 /**
  * @brief InfluxDB function protoypes
  */
-// Write Data via InfluxDB CLI
-bool influxdb_send_measurements(uint64_t rtt_avg_us, uint64_t rtt_min_us, uint64_t rtt_max_us, 
-                            uint64_t jitter_us, uint8_t loss_pct, float temperature_c);
-// Separate function to send failed measurement attempt results
-bool influxdb_send_failure(float temperature_c);
+// Queue a measurement (or failed measurement attempt) into the upload batch
+bool influxdb_queue_measurements(const Influx_Measurement_t *meas);
+// Check whether the upload batch should be sent
+bool influxdb_batch_due(void);
+// Send the upload batch
+bool influxdb_flush(void);
+// Send an anomaly-onset point ahead of the upload batch
+bool influxdb_send_anomaly(const Influx_Measurement_t *meas, const Adaptive_Handle_t *adaptive);
+// Send recorded Wi-Fi connection events
+bool influxdb_send_wifi_events(const Wifi_Event_t *events, uint16_t count);
+// Send time synchronisation offset and drift
+bool influxdb_send_timesync(const Timesync_Status_t *status);
+// Send stack overhead calibration result
+bool influxdb_send_calibration(const Ping_Calibration_t *cal);
+// Send burst probing aggregate
+bool influxdb_send_burst(const Ping_Burst_t *burst, uint64_t capture_us);
+// Send one compressed per-packet trace block
+bool influxdb_send_trace(const uint8_t *block, size_t len, uint16_t records,
+                        uint16_t first_seq, uint64_t capture_us);
+// Send payload-size sweep and packet-train capacity estimate
+bool influxdb_send_capacity(const Ping_Sweep_t *sweep, const Ping_Train_t *train, uint64_t capture_us);
+// Send the latency summary of one power management A/B window
+bool influxdb_send_power_mode(const char *mode, uint32_t pm_value, const Stats_Summary_t *summary,
+                              uint32_t cycles, uint64_t capture_us);
+// Send per access category probe results
+bool influxdb_send_qos(const Ping_Qos_t *qos, const char *load, uint64_t capture_us);
+// Send TCP goodput test result
+bool influxdb_send_goodput(const Goodput_Result_t *result, uint64_t capture_us);
+// Send a sliding-window aggregate
+bool influxdb_send_window(const char *window, const Stats_Summary_t *summary, uint64_t capture_us);
 // Backoff delay calculation
 uint32_t calculate_backoff_delay(uint32_t *retry_c, uint32_t *retry_delay);
 
@@ -0,0 +1,37 @@
+#ifndef LINEPROTO_H
+#define LINEPROTO_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Wi-Fi measurement point structure definition
+ */
+typedef struct {
+    uint64_t rtt_avg_us;    // Average round trip time
+    uint64_t rtt_min_us;    // Minimum round trip time
+    uint64_t rtt_max_us;    // Maximum round trip time
+    uint64_t jitter_us;     // Jitter
+    uint8_t loss_pct;       // Packet loss percentage
+    float temperature_c;    // Temperature in Celsius
+    uint64_t rtt_avg_corr_us;   // Average RTT less the device-side stack cost
+    uint64_t rtt_min_corr_us;   // Minimum RTT less the device-side stack cost
+    uint64_t rtt_max_corr_us;   // Maximum RTT less the device-side stack cost
+    uint64_t capture_us;    // time_us_64() when the measurement was taken
+    const char *pm_mode;    // Power management profile tag, NULL when not rotating profiles
+    bool failed;            // No replies, only loss and temperature are valid
+} Influx_Measurement_t;
+
+/**
+ * @brief Line protocol function protoypes
+ * @note Pure formatting kernels shared by the uploader and the benchmarks
+ */
+// Format the point timestamp (ms precision), empty when unix_us is 0
+int lineproto_format_timestamp(char *buf, size_t size, uint64_t unix_us);
+// Format a wifi_measurements point
+int lineproto_format_measurements(char *buf, size_t size, const Influx_Measurement_t *meas, uint64_t unix_us);
+
+#endif /* LINEPROTO_H */
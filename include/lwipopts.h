@@ -19,21 +19,40 @@
 #define MEM_LIBC_MALLOC             0
 #endif
 #define MEM_ALIGNMENT               4
+#ifndef LWIP_LOW_FOOTPRINT
+#define LWIP_LOW_FOOTPRINT          0
+#endif
+#if LWIP_LOW_FOOTPRINT
+// Reduced-RAM profile (cmake -DLWIP_LOW_FOOTPRINT=ON): one InfluxDB upload and one
+// goodput transfer on the heap, echo requests live in static storage (ping.c)
+#define MEM_SIZE                    (16 * 1024)
+#define MEMP_NUM_TCP_SEG            32
+#define MEMP_NUM_ARP_QUEUE          4
+#define PBUF_POOL_SIZE              32
+#define MEMP_NUM_TCP_PCB            4
+#else
 #define MEM_SIZE                    (64 * 1024)
 #define MEMP_NUM_TCP_SEG            128
 #define MEMP_NUM_ARP_QUEUE          10
 #define PBUF_POOL_SIZE              96
-#define PBUF_POOL_BUFSIZE           (1600)
 #define MEMP_NUM_TCP_PCB           12
+#endif
+#define PBUF_POOL_BUFSIZE           (1600)
 #define LWIP_ARP                    1
 #define LWIP_ETHERNET               1
 #define LWIP_ICMP                   1
 #define LWIP_RAW                    1
 #define LWIP_NETBUF_RECVINFO        1
-#define TCP_WND                     (8 * TCP_MSS)
 #define TCP_MSS                     1460
+#if LWIP_LOW_FOOTPRINT
+#define TCP_WND                     (4 * TCP_MSS)
+#define TCP_SND_BUF                 (4 * TCP_MSS)
+#define TCP_SND_QUEUELEN            16
+#else
+#define TCP_WND                     (8 * TCP_MSS)
 #define TCP_SND_BUF                 (8 * TCP_MSS)
 #define TCP_SND_QUEUELEN            128
+#endif
 #define LWIP_NETIF_STATUS_CALLBACK  1
 #define LWIP_NETIF_LINK_CALLBACK    1
 #define LWIP_NETIF_HOSTNAME         1
@@ -51,13 +70,41 @@
 #define LWIP_DNS                    1
 #define LWIP_TCP_KEEPALIVE          1
 #define LWIP_NETIF_TX_SINGLE_PBUF   1
+// Echo requests are custom pbufs over static storage
+#define LWIP_SUPPORT_CUSTOM_PBUF    1
 #define DHCP_DOES_ARP_CHECK         0
 #define LWIP_DHCP_DOES_ACD_CHECK    0
 
+// SNTP time synchronisation, clock model lives in timesync.c
+#define SNTP_SERVER_DNS             0
+#define SNTP_COMP_ROUNDTRIP         1
+#define SNTP_UPDATE_DELAY           (10 * 60 * 1000)
+#define SNTP_SET_SYSTEM_TIME_US(sec, us)    timesync_set_system_time_us((sec), (us))
+#define SNTP_GET_SYSTEM_TIME(sec, us)       timesync_get_system_time_us(&(sec), &(us))
+#include <stdint.h>
+void timesync_set_system_time_us(uint32_t sec, uint32_t us);
+void timesync_get_system_time_us(uint32_t *sec, uint32_t *us);
+
+#include "config.h"
+
 #ifndef NDEBUG
 #define LWIP_DEBUG                  1
 #define LWIP_STATS                  1
 #define LWIP_STATS_DISPLAY          1
+#elif GOODPUT_ENABLE
+// The goodput test reports TCP retransmits, keep only the TCP counters in release builds
+#define LWIP_STATS                  1
+#define LWIP_STATS_DISPLAY          0
+#define LINK_STATS                  0
+#define ETHARP_STATS                0
+#define IP_STATS                    0
+#define IPFRAG_STATS                0
+#define ICMP_STATS                  0
+#define UDP_STATS                   0
+#define TCP_STATS                   1
+#define MEM_STATS                   0
+#define MEMP_STATS                  0
+#define SYS_STATS                   0
 #endif
 
 #define ETHARP_DEBUG                LWIP_DBG_OFF
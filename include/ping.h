@@ -7,39 +7,127 @@
 #include "lwip/raw.h"
 #include "lwip/icmp.h"
 #include "lwip/pbuf.h"
+#include "lwip/netif.h"
 #include "lwip/inet_chksum.h"
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include "config.h"
-
-typedef struct __attribute__((packed)) {
-    uint8_t type;        // ICMP type
-    uint8_t code;        // ICMP code
-    uint16_t checksum;   // ICMP checksum
-    uint16_t id;         // Identifier
-    uint16_t sequence;   // Sequence number
-    uint32_t timestamp;   // Timestamp in ms
-} ICMP_EchoHeader_t;
-
+#include "stats.h"
+#include "trace.h"
+#include "echo.h"
 
 /**
  * @brief Ping handle structure definition
  */
 typedef struct {
-    uint64_t rtt_us[MAX_PING_COUNT];
+    uint64_t rtt_us[MAX_PING_COUNT];    // Raw RTT, raw_sendto() call until the receive callback
+    uint32_t stack_us[MAX_PING_COUNT];  // Send plus receive path cost of each reply
     uint16_t sent;
     uint16_t received;
 } Ping_Handle_t;
 
+/**
+ * @brief Distribution summary of device-side path cost samples
+ */
+typedef struct {
+    uint16_t samples;
+    uint32_t min_us;
+    uint32_t median_us;
+    uint32_t p90_us;
+    uint32_t max_us;
+} Ping_Distribution_t;
+
+/**
+ * @brief Stack overhead calibration result
+ */
+typedef struct {
+    Ping_Distribution_t tx_path;    // raw_sendto() until the frame is handed to the driver
+    Ping_Distribution_t rx_path;    // Driver hands the frame to lwIP until the receive callback
+} Ping_Calibration_t;
+
+/**
+ * @brief Burst probing result
+ */
+typedef struct {
+    Stats_Summary_t summary;    // RTT summary and histogram of the burst
+    uint16_t sent;              // Probes sent
+    uint16_t skipped;           // Probes not sent because a guard tripped
+    uint16_t rate_hz;           // Probe rate used
+    uint32_t duration_ms;       // Probe window length
+} Ping_Burst_t;
+
+/**
+ * @brief Payload-size sweep result
+ */
+typedef struct {
+    uint16_t payload[PING_SWEEP_STEPS];     // Echo payload size per step
+    uint32_t min_rtt_us[PING_SWEEP_STEPS];  // Minimum RTT per step, 0 if no reply
+    uint8_t valid_steps;                    // Steps with at least one reply
+    float slope_ns_per_byte;                // Round-trip cost per payload byte
+    float intercept_us;                     // Extrapolated RTT of an empty echo
+} Ping_Sweep_t;
+
+/**
+ * @brief Packet-train capacity estimate
+ */
+typedef struct {
+    uint16_t sent;              // Probes sent over all trains
+    uint16_t received;          // Replies received over all trains
+    uint16_t gaps;              // Dispersion samples (consecutive reply pairs)
+    uint16_t packet_bytes;      // IP packet size of every probe
+    uint32_t dispersion_us;     // Median spacing of consecutive replies
+    float capacity_mbps;        // packet_bytes * 8 / dispersion_us
+} Ping_Train_t;
+
+/**
+ * @brief WMM access categories probed with DSCP-marked echoes
+ */
+typedef enum {
+    PING_AC_VO = 0,
+    PING_AC_VI,
+    PING_AC_BE,
+    PING_AC_BK,
+    PING_AC_COUNT
+} Ping_AccessCategory_t;
+
+/**
+ * @brief Per access category probing result
+ */
+typedef struct {
+    Stats_Summary_t summary[PING_AC_COUNT];     // RTT summary per access category
+    uint8_t dscp[PING_AC_COUNT];                // DSCP the probes were marked with
+} Ping_Qos_t;
+
 /**
  * @brief Ping function protoypes
  */
+// Create the persistent raw PCB and echo request pool (after Wi-Fi init)
+bool ping_init(void);
+// Release the raw PCB and echo request pool (before Wi-Fi deinit)
+void ping_deinit(void);
 // Ping measurement
 bool ping_measure(Ping_Handle_t *ping_handle, const char *ip_addr);
+// Single untraced echo bounded by timeout_ms
+bool ping_once(const char *ip_addr, uint32_t timeout_ms, uint32_t *rtt_us);
 // Ping statistics calculation
 bool ping_calculate_stats(Ping_Handle_t *ping_handle, uint64_t *avg_rtt_us, 
                         uint64_t *min_rtt_us, uint64_t *max_rtt_us, 
                         uint64_t *jitt_us, uint8_t *loss_p);
+// Average, minimum and maximum RTT with each reply's stack cost subtracted
+bool ping_corrected_stats(const Ping_Handle_t *ping_handle, uint64_t *avg_rtt_us,
+                          uint64_t *min_rtt_us, uint64_t *max_rtt_us);
+// Measure device-side send and receive path cost
+bool ping_calibrate(Ping_Calibration_t *cal, const char *ip_addr);
+// High-rate burst probing with on-device aggregation
+bool ping_burst(Ping_Burst_t *burst, const char *ip_addr);
+// Minimum RTT against echo payload size, fitted to a per-byte cost
+bool ping_sweep(Ping_Sweep_t *sweep, const char *ip_addr);
+// Bottleneck capacity from the dispersion of back-to-back probe replies
+bool ping_train(Ping_Train_t *train, const char *ip_addr);
+// Interleaved DSCP-marked probes, one summary per WMM access category
+bool ping_qos(Ping_Qos_t *qos, const char *ip_addr, uint64_t deadline_us);
+// Access category tag name
+const char *ping_ac_name(Ping_AccessCategory_t ac);
 
-#endif /* PING_H */
\ No newline at end of file
+#endif /* PING_H */
@@ -5,6 +5,7 @@
 #include "pico/stdlib.h"
 #include "hardware/adc.h"
 #include "hardware/resets.h"
+#include "sensors_conv.h"
 
 // Number of ADC samples to average for temperature reading
 #define TEMP_SAMPLE_COUNT 512
@@ -0,0 +1,13 @@
+#ifndef SENSORS_CONV_H
+#define SENSORS_CONV_H
+
+#include <stdint.h>
+
+/**
+ * @brief Sensor conversion function protoypes
+ * @note Pure arithmetic, shared by the sensor driver and the benchmarks
+ */
+// Average summed ADC samples and convert them to degrees Celsius
+float temperature_from_adc(uint32_t sum, uint32_t count);
+
+#endif /* SENSORS_CONV_H */
@@ -0,0 +1,70 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Number of latency histogram bins, the last bin is open-ended
+#define STATS_HIST_BINS         16
+
+/**
+ * @brief Latency summary structure definition
+ * @note All fields are additive (or min/max), so summaries can be merged
+ */
+typedef struct {
+    uint32_t count;                 // Number of RTT samples
+    uint32_t lost;                  // Number of lost probes
+    uint64_t sum_us;                // Sum of RTT samples
+    uint64_t sum_sq_us;             // Sum of squared RTT samples
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t bins[STATS_HIST_BINS]; // Latency histogram
+} Stats_Summary_t;
+
+// Maximum number of sub-window buckets in a sliding window
+#define STATS_WINDOW_MAX_BUCKETS 15
+
+/**
+ * @brief Sliding window of bucketed summaries
+ * @note Samples go into the newest bucket and are added to the running total;
+ * whole buckets are subtracted from the total as they expire
+ */
+typedef struct {
+    Stats_Summary_t buckets[STATS_WINDOW_MAX_BUCKETS];
+    Stats_Summary_t total;      // Sum of all buckets
+    uint64_t bucket_us;         // Bucket width
+    uint64_t head_start_us;     // Start of the newest bucket
+    uint8_t num_buckets;
+    uint8_t head;               // Index of the newest bucket
+} Stats_Window_t;
+
+/**
+ * @brief Statistics function protoypes
+ */
+// Reset a summary to empty
+void stats_reset(Stats_Summary_t *summary);
+// Add an RTT sample
+void stats_add(Stats_Summary_t *summary, uint32_t rtt_us);
+// Add a lost probe
+void stats_add_loss(Stats_Summary_t *summary);
+// Mean RTT
+uint32_t stats_mean_us(const Stats_Summary_t *summary);
+// RTT standard deviation
+uint32_t stats_stddev_us(const Stats_Summary_t *summary);
+// RTT percentile estimated from the histogram
+uint32_t stats_percentile_us(const Stats_Summary_t *summary, uint8_t pct);
+// Loss percentage
+float stats_loss_pct(const Stats_Summary_t *summary);
+// Upper edge of a histogram bin, UINT32_MAX for the last bin
+uint32_t stats_bin_edge_us(uint8_t bin);
+// Set up a sliding window of num_buckets buckets of bucket_ms each
+bool stats_window_init(Stats_Window_t *window, uint32_t bucket_ms, uint8_t num_buckets, uint64_t now_us);
+// Add an RTT sample to a sliding window
+void stats_window_add(Stats_Window_t *window, uint64_t now_us, uint32_t rtt_us);
+// Add a lost probe to a sliding window
+void stats_window_add_loss(Stats_Window_t *window, uint64_t now_us);
+// Summary of the samples currently inside the window
+const Stats_Summary_t *stats_window_get(Stats_Window_t *window, uint64_t now_us);
+
+#endif /* STATS_H */
@@ -0,0 +1,40 @@
+#ifndef TIMESYNC_H
+#define TIMESYNC_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/ip_addr.h"
+#include "lwip/apps/sntp.h"
+#include "config.h"
+
+/**
+ * @brief Time synchronisation status structure definition
+ */
+typedef struct {
+    bool synced;            // At least one SNTP response was applied
+    uint32_t syncs;         // Number of SNTP responses applied
+    int64_t step_us;        // Correction applied by the last sync (precision estimate)
+    int32_t drift_ppb;      // Estimated local clock drift against the NTP server
+    uint64_t last_sync_us;  // time_us_64() of the last sync
+} Timesync_Status_t;
+
+/**
+ * @brief Time synchronisation function protoypes
+ */
+// Start periodic SNTP synchronisation (Wi-Fi must be connected)
+bool timesync_start(void);
+// Stop SNTP synchronisation before Wi-Fi is de-initialized
+void timesync_stop(void);
+// Convert a time_us_64() capture time to Unix time in microseconds
+uint64_t timesync_to_unix_us(uint64_t local_us);
+// Get a snapshot of the synchronisation status
+void timesync_get_status(Timesync_Status_t *status);
+// SNTP hooks called by lwIP, see lwipopts.h
+void timesync_set_system_time_us(uint32_t sec, uint32_t us);
+void timesync_get_system_time_us(uint32_t *sec, uint32_t *us);
+
+#endif /* TIMESYNC_H */
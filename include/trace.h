@@ -0,0 +1,56 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "config.h"
+
+#if TRACE_BLOCK_RECORDS > 0x3fff
+#error "TRACE_BLOCK_RECORDS must fit the two byte record count"
+#endif
+
+// Trace block format version
+#define TRACE_BLOCK_VERSION     1
+// Header flag: base timestamp is Unix time rather than time_us_64()
+#define TRACE_FLAG_UNIX_TIME    0x01
+// Worst case encoded size of one record (three varints)
+#define TRACE_RECORD_MAX_BYTES  18
+// Worst case encoded size of the block header
+#define TRACE_HEADER_MAX_BYTES  17
+
+/**
+ * @brief Per-probe trace record
+ */
+typedef struct {
+    uint64_t tx_us;     // time_us_64() when the probe was sent
+    uint32_t rtt_us;    // Round trip time, unused when lost
+    uint16_t seq;       // ICMP sequence number
+    bool lost;          // No reply before the timeout
+} Trace_Record_t;
+
+/**
+ * @brief Trace function protoypes
+ * @note Records are added from lwIP context, callers outside of it must hold
+ * the lwIP lock
+ */
+// Record a probe reply
+void trace_record(uint16_t seq, uint64_t tx_us, uint32_t rtt_us);
+// Record a lost probe
+void trace_record_loss(uint16_t seq, uint64_t tx_us);
+// Number of records waiting for upload
+uint16_t trace_pending(void);
+// Encode the oldest records into a compressed block
+size_t trace_encode_block(uint8_t *out, size_t size, uint64_t base_us, bool unix_time,
+                        uint16_t *records);
+// Oldest pending record
+bool trace_peek(Trace_Record_t *record);
+// Remove records once their block has been uploaded
+void trace_consume(uint16_t count);
+// Records overwritten before they were uploaded
+uint32_t trace_dropped_count(void);
+// Base64 encode a block for transport in a line protocol string field
+size_t trace_base64(const uint8_t *in, size_t len, char *out, size_t size);
+
+#endif /* TRACE_H */
@@ -5,8 +5,46 @@
 #include <stdbool.h>
 #include "pico/stdlib.h"
 #include "pico/cyw43_arch.h"
+#include "lwip/netif.h"
 #include "config.h"
 
+/**
+ * @brief Wi-Fi connection event types
+ */
+typedef enum {
+    WIFI_EVENT_LINK_DOWN = 0,   // Link loss detected, outage starts
+    WIFI_EVENT_DRIVER_INIT,     // CYW43 driver and lwIP initialized
+    WIFI_EVENT_AUTH,            // 802.11 authentication completed
+    WIFI_EVENT_ASSOC,           // Association completed, link is up
+    WIFI_EVENT_KEYED,           // WPA2 handshake completed
+    WIFI_EVENT_DHCP,            // IP address obtained via DHCP
+    WIFI_EVENT_CONNECT_FAIL,    // Connection attempt failed
+    WIFI_EVENT_LINK_UP,         // Connectivity restored, outage ends
+    WIFI_EVENT_COUNT
+} Wifi_EventType_t;
+
+/**
+ * @brief Wi-Fi connection event record
+ */
+typedef struct {
+    uint64_t timestamp_us;  // time_us_64() when the event was recorded
+    uint32_t duration_us;   // Time spent in this phase (whole outage for LINK_UP)
+    uint8_t type;           // Wifi_EventType_t
+    uint8_t attempt;        // Connection attempt number within the outage
+    int16_t status;         // CYW43 link status when the event was recorded
+} Wifi_Event_t;
+
+/**
+ * @brief Wi-Fi power management profiles
+ */
+typedef enum {
+    WIFI_PM_OFF = 0,            // Power save disabled (default)
+    WIFI_PM_PERFORMANCE,        // CYW43_PERFORMANCE_PM, PM2 with 200 ms sleep return
+    WIFI_PM_AGGRESSIVE,         // CYW43_AGGRESSIVE_PM, PM1 (PS-Poll)
+    WIFI_PM_CUSTOM,             // PM2 with the WIFI_PM_CUSTOM_* listen intervals
+    WIFI_PM_COUNT
+} Wifi_PowerMode_t;
+
 /**
  * @brief Wi-Fi function protoypes
  */
@@ -18,5 +56,19 @@ bool wifi_is_connected(void);
 void wifi_process(void);
 // Wi-Fi de-initialization
 void wifi_deinit(void);
+// Select the power management profile, kept across reinitialization
+bool wifi_set_power_mode(Wifi_PowerMode_t mode);
+// Active power management profile
+Wifi_PowerMode_t wifi_get_power_mode(void);
+// Value passed to cyw43_wifi_pm() for a profile
+uint32_t wifi_power_mode_value(Wifi_PowerMode_t mode);
+// Power management profile name for reporting
+const char *wifi_power_mode_name(Wifi_PowerMode_t mode);
+// Copy oldest recorded connection events without removing them
+uint16_t wifi_events_peek(Wifi_Event_t *events, uint16_t max_events);
+// Remove oldest connection events once they have been uploaded
+void wifi_events_consume(uint16_t count);
+// Connection event name for reporting
+const char *wifi_event_name(uint8_t type);
 
-#endif /* WIFI_H */
\ No newline at end of file
+#endif /* WIFI_H */
@@ -0,0 +1,148 @@
+#include "adaptive.h"
+#include <math.h>
+
+/* Private function prototypes -----------------------------------------------*/
+static void adaptive_learn(Adaptive_Handle_t *handle, bool rtt_valid, float rtt_us, float loss);
+static Adaptive_Event_t adaptive_back_off(Adaptive_Handle_t *handle);
+
+
+/**
+ * @brief Reset the adaptive sampling controller
+ * @param handle Pointer to controller handle
+ */
+void adaptive_init(Adaptive_Handle_t *handle) {
+    memset(handle, 0, sizeof(*handle));
+    handle->state = ADAPTIVE_STATE_NORMAL;
+    handle->interval_ms = MEASUREMENT_INTERVAL_MS;
+}
+
+/**
+ * @brief Feed one measurement cycle into the change-point detector
+ * @param handle Pointer to controller handle
+ * @param rtt_valid false if no reply was received in this cycle
+ * @param rtt_us Average RTT of the cycle in microseconds
+ * @param loss_pct Packet loss of the cycle in percent
+ * @return ADAPTIVE_EVENT_ONSET when an anomaly starts, ADAPTIVE_EVENT_END when
+ * the interval is back to nominal, ADAPTIVE_EVENT_NONE otherwise
+ * @note Two one-sided CUSUM detectors run against an EWMA baseline: one on the
+ * RTT normalized by the baseline deviation, one on the loss fraction. The
+ * baseline is frozen while an anomaly is active so it does not absorb the shift,
+ * and the anomaly ends after ADAPTIVE_CALM_CYCLES cycles within the control limit.
+ * An anomaly lasting ADAPTIVE_MAX_ANOMALY_CYCLES re-learns the baseline while the
+ * interval backs off, replies or not.
+ */
+Adaptive_Event_t adaptive_update(Adaptive_Handle_t *handle, bool rtt_valid,
+                                uint64_t rtt_us, uint8_t loss_pct) {
+    float loss = loss_pct / 100.0f;
+
+    // Warm up the baseline on cycles with replies before detecting anything
+    if (handle->samples < ADAPTIVE_WARMUP_SAMPLES) {
+        if (rtt_valid) {
+            adaptive_learn(handle, rtt_valid, (float)rtt_us, loss);
+        }
+        // Re-learning after a persistent anomaly, which may be an outage without
+        // replies, must not hold the fastest interval
+        if (ADAPTIVE_STATE_DECAY == handle->state) {
+            return adaptive_back_off(handle);
+        }
+        return ADAPTIVE_EVENT_NONE;
+    }
+
+    float sigma = sqrtf(handle->rtt_var_us2);
+    if (sigma < ADAPTIVE_MIN_SIGMA_US) {
+        sigma = ADAPTIVE_MIN_SIGMA_US;
+    }
+    handle->last_z = rtt_valid ? ((float)rtt_us - handle->rtt_mean_us) / sigma : 0.0f;
+
+    // A cycle is calm when it is within the control limit of the baseline
+    bool calm = handle->last_z < ADAPTIVE_CALM_Z && (loss - handle->loss_mean) < ADAPTIVE_LOSS_K;
+
+    switch (handle->state) {
+    case ADAPTIVE_STATE_NORMAL:
+        handle->cusum_rtt = fmaxf(0.0f, handle->cusum_rtt + handle->last_z - ADAPTIVE_CUSUM_K);
+        handle->cusum_loss = fmaxf(0.0f, handle->cusum_loss + (loss - handle->loss_mean) - ADAPTIVE_LOSS_K);
+        if (handle->cusum_rtt > ADAPTIVE_CUSUM_H || handle->cusum_loss > ADAPTIVE_LOSS_H) {
+            handle->state = ADAPTIVE_STATE_ANOMALY;
+            handle->interval_ms = ADAPTIVE_MIN_INTERVAL_MS;
+            handle->calm_cycles = 0;
+            handle->anomaly_cycles = 0;
+            handle->cusum_rtt = 0.0f;
+            handle->cusum_loss = 0.0f;
+            return ADAPTIVE_EVENT_ONSET;
+        }
+        adaptive_learn(handle, rtt_valid, (float)rtt_us, loss);
+        return ADAPTIVE_EVENT_NONE;
+
+    case ADAPTIVE_STATE_ANOMALY:
+        handle->anomaly_cycles++;
+        handle->calm_cycles = calm ? handle->calm_cycles + 1 : 0;
+        if (handle->calm_cycles >= ADAPTIVE_CALM_CYCLES) {
+            handle->state = ADAPTIVE_STATE_DECAY;
+        } else if (handle->anomaly_cycles >= ADAPTIVE_MAX_ANOMALY_CYCLES) {
+            // Persistent level shift, accept it as the new baseline
+            DBG("Adaptive: anomaly persisted, re-learning baseline\n");
+            handle->samples = 0;
+            handle->state = ADAPTIVE_STATE_DECAY;
+        }
+        return ADAPTIVE_EVENT_NONE;
+
+    case ADAPTIVE_STATE_DECAY:
+        if (!calm) {
+            // Still part of the same anomaly, no new onset
+            handle->state = ADAPTIVE_STATE_ANOMALY;
+            handle->interval_ms = ADAPTIVE_MIN_INTERVAL_MS;
+            handle->calm_cycles = 0;
+            return ADAPTIVE_EVENT_NONE;
+        }
+        return adaptive_back_off(handle);
+
+    default:
+        adaptive_init(handle);
+        return ADAPTIVE_EVENT_NONE;
+    }
+}
+
+/**
+ * @brief Interval until the next measurement cycle
+ * @param handle Pointer to controller handle
+ * @return Interval in milliseconds
+ */
+uint32_t adaptive_interval_ms(const Adaptive_Handle_t *handle) {
+    return handle->interval_ms;
+}
+
+/**
+ * @brief Lengthen the interval by ADAPTIVE_DECAY_FACTOR, up to the nominal one
+ * @param handle Pointer to controller handle
+ * @return ADAPTIVE_EVENT_END when the nominal interval is reached, ADAPTIVE_EVENT_NONE otherwise
+ */
+static Adaptive_Event_t adaptive_back_off(Adaptive_Handle_t *handle) {
+    handle->interval_ms *= ADAPTIVE_DECAY_FACTOR;
+    if (handle->interval_ms >= MEASUREMENT_INTERVAL_MS) {
+        handle->interval_ms = MEASUREMENT_INTERVAL_MS;
+        handle->state = ADAPTIVE_STATE_NORMAL;
+        return ADAPTIVE_EVENT_END;
+    }
+    return ADAPTIVE_EVENT_NONE;
+}
+
+/**
+ * @brief Update the EWMA baseline with one cycle
+ * @param handle Pointer to controller handle
+ * @param rtt_valid false if the cycle has no RTT sample
+ * @param rtt_us Average RTT of the cycle
+ * @param loss Loss fraction of the cycle
+ */
+static void adaptive_learn(Adaptive_Handle_t *handle, bool rtt_valid, float rtt_us, float loss) {
+    // Plain average while warming up, then EWMA
+    float alpha = (handle->samples < ADAPTIVE_WARMUP_SAMPLES) ?
+        1.0f / (handle->samples + 1) : ADAPTIVE_EWMA_ALPHA;
+
+    handle->loss_mean += alpha * (loss - handle->loss_mean);
+    if (rtt_valid) {
+        float diff = rtt_us - handle->rtt_mean_us;
+        handle->rtt_mean_us += alpha * diff;
+        handle->rtt_var_us2 = (1.0f - alpha) * (handle->rtt_var_us2 + alpha * diff * diff);
+    }
+    handle->samples++;
+}
@@ -0,0 +1,51 @@
+#include "echo.h"
+
+/**
+ * @brief Write the echo request header in front of the padding and checksum the message
+ * @param[in,out] msg ICMP message, the padding after the header is left as is
+ * @param[in] len Message length including the header
+ * @param[in] seq Sequence number
+ * @param[in] timestamp_ms Send time in milliseconds
+ */
+void echo_build_request(uint8_t *msg, uint16_t len, uint16_t seq, uint32_t timestamp_ms) {
+    ICMP_EchoHeader_t *icmp_hdr = (ICMP_EchoHeader_t *)msg;
+
+    icmp_hdr->type = ICMP_ECHO;
+    icmp_hdr->code = 0;
+    icmp_hdr->checksum = 0;
+    icmp_hdr->id = lwip_htons(PING_ECHO_ID);
+    icmp_hdr->sequence = lwip_htons(seq);
+    icmp_hdr->timestamp = lwip_htonl(timestamp_ms);
+
+    // Calculate checksum
+    icmp_hdr->checksum = inet_chksum(msg, len);
+}
+
+/**
+ * @brief Validate an echo reply and extract its sequence number
+ * @param[in] pkt Packet starting at the IP header
+ * @param[in] len Packet length
+ * @param[out] seq Sequence number of the reply
+ * @return ECHO_REPLY_OK for a valid reply to our probes, see Echo_Reply_t
+ */
+Echo_Reply_t echo_parse_reply(const uint8_t *pkt, uint16_t len, uint16_t *seq) {
+    const struct ip_hdr *ip_hdr = (const struct ip_hdr *)pkt;
+    uint16_t hdr_len = IPH_HL(ip_hdr) * 4;
+
+    if (len < hdr_len + sizeof(ICMP_EchoHeader_t)) {
+        return ECHO_REPLY_NOT_OURS;
+    }
+
+    const ICMP_EchoHeader_t *icmp_hdr = (const ICMP_EchoHeader_t *)(pkt + hdr_len);
+    if (icmp_hdr->type != ICMP_ER || lwip_ntohs(icmp_hdr->id) != PING_ECHO_ID) {
+        return ECHO_REPLY_NOT_OURS;
+    }
+
+    // Checksum over the whole message including the checksum field is 0 when valid
+    if (0 != inet_chksum(icmp_hdr, len - hdr_len)) {
+        return ECHO_REPLY_CORRUPT;
+    }
+
+    *seq = lwip_ntohs(icmp_hdr->sequence);
+    return ECHO_REPLY_OK;
+}
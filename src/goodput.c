@@ -0,0 +1,311 @@
+#include "goodput.h"
+
+/* Private variables ---------------------------------------------------------*/
+// Upload data, queued by reference with tcp_write() (no COPY flag), never modified
+static uint8_t goodput_buf[TCP_MSS];
+static const uint8_t goodput_cmd[2] = { GOODPUT_CMD_UPLOAD, GOODPUT_CMD_DOWNLOAD };
+static struct tcp_pcb *goodput_pcb = NULL;
+static volatile bool goodput_upload = false;
+static volatile bool goodput_connected = false;
+static volatile bool goodput_ended = false;
+static volatile bool goodput_stop = false;
+static volatile uint64_t goodput_bytes = 0;
+static volatile uint64_t goodput_start_us = 0;
+static volatile uint64_t goodput_end_us = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+static bool goodput_transfer(bool upload, Goodput_Direction_t *dir);
+static void goodput_probe(uint64_t deadline_us, uint64_t *rtt_sum_us, uint32_t *replies);
+static void goodput_fill(struct tcp_pcb *tpcb);
+static void goodput_close(void);
+static void goodput_error_callback(void *arg, err_t err);
+static err_t goodput_connected_callback(void *arg, struct tcp_pcb *tpcb, err_t err);
+static err_t goodput_sent_callback(void *arg, struct tcp_pcb *tpcb, u16_t len);
+static err_t goodput_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+
+
+/**
+ * @brief Run an upload and a download transfer against the goodput sink
+ * @param[out] result Pointer to goodput result
+ * @return true if at least one direction moved data, false otherwise
+ * @note The router RTT is probed before the test (idle) and throughout each
+ * transfer (loaded); the difference is the queueing delay the transfer adds.
+ * With QOS_ENABLE each transfer also carries one round of per access category
+ * probes once it is a quarter in, so AP queueing is compared under contention
+ */
+bool goodput_run(Goodput_Result_t *result) {
+    if (NULL == result) {
+        DBG("Invalid parameters\n");
+        return false;
+    }
+
+    memset(result, 0, sizeof(*result));
+    for (size_t i = 0; i < sizeof(goodput_buf); i++) {
+        goodput_buf[i] = (uint8_t)i;
+    }
+
+    uint64_t rtt_sum_us = 0;
+    uint32_t replies = 0;
+    for (int i = 0; i < MAX_PING_COUNT; i++) {
+        goodput_probe(time_us_64() + PING_TIMEOUT_MS * 1000ULL, &rtt_sum_us, &replies);
+    }
+    result->rtt_idle_us = replies ? (uint32_t)(rtt_sum_us / replies) : 0;
+
+    goodput_transfer(true, &result->up);
+    goodput_transfer(false, &result->down);
+
+    DBG("Goodput: up %.2f Mbit/s, down %.2f Mbit/s, idle RTT %lu us\n",
+        result->up.goodput_mbps, result->down.goodput_mbps, result->rtt_idle_us);
+    return result->up.ok || result->down.ok;
+}
+
+/**
+ * @brief Run one bounded transfer and probe the router RTT meanwhile
+ * @param upload true to stream to the sink, false to stream from it
+ * @param[out] dir Result of the transfer
+ * @return true if data was moved, false otherwise
+ */
+static bool goodput_transfer(bool upload, Goodput_Direction_t *dir) {
+    ip_addr_t sink_ip;
+    sink_ip.addr = ipaddr_addr(GOODPUT_SINK_IP);
+    if (IPADDR_NONE == sink_ip.addr) {
+        DBG("Invalid goodput sink IP address: %s\n", GOODPUT_SINK_IP);
+        return false;
+    }
+
+    cyw43_arch_lwip_begin();
+    goodput_pcb = tcp_new();
+    if (NULL == goodput_pcb) {
+        cyw43_arch_lwip_end();
+        DBG("Failed to create TCP control block\n");
+        return false;
+    }
+
+    goodput_upload = upload;
+    goodput_connected = false;
+    goodput_ended = false;
+    goodput_stop = false;
+    goodput_bytes = 0;
+    goodput_start_us = 0;
+    goodput_end_us = 0;
+
+    tcp_arg(goodput_pcb, NULL);
+    tcp_err(goodput_pcb, goodput_error_callback);
+    tcp_recv(goodput_pcb, goodput_recv_callback);
+    tcp_sent(goodput_pcb, goodput_sent_callback);
+#if TCP_STATS
+    STAT_COUNTER rexmit_start = lwip_stats.tcp.rexmit;
+#endif
+    err_t err = tcp_connect(goodput_pcb, &sink_ip, GOODPUT_SINK_PORT, goodput_connected_callback);
+    cyw43_arch_lwip_end();
+
+    if (ERR_OK != err) {
+        DBG("TCP connect error: %d\n", err);
+        goodput_close();
+        return false;
+    }
+
+    uint64_t timeout = time_us_64() + GOODPUT_CONNECT_TIMEOUT_MS * 1000ULL;
+    while (!goodput_connected && !goodput_ended && time_us_64() < timeout) {
+        cyw43_arch_poll();
+        sleep_ms(1);
+    }
+    if (!goodput_connected) {
+        DBG("Goodput sink %s:%d not reachable\n", GOODPUT_SINK_IP, GOODPUT_SINK_PORT);
+        goodput_close();
+        return false;
+    }
+
+    // Keep probing the router while the transfer runs
+    uint64_t rtt_sum_us = 0;
+    uint32_t replies = 0;
+    uint64_t end_us = goodput_start_us + GOODPUT_DURATION_MS * 1000ULL;
+    // Past slow start the link is loaded
+    uint64_t qos_start_us = goodput_start_us + GOODPUT_DURATION_MS * 250ULL;
+    bool qos_pending = QOS_ENABLE;
+    while (!goodput_ended && time_us_64() < end_us) {
+        if (qos_pending && time_us_64() >= qos_start_us) {
+            dir->qos_ok = ping_qos(&dir->qos, ROUTER_IP_ADDR, end_us);
+            qos_pending = false;
+            continue;
+        }
+        goodput_probe(end_us, &rtt_sum_us, &replies);
+    }
+
+    cyw43_arch_lwip_begin();
+    goodput_stop = true;
+    if (0 == goodput_end_us) {
+        goodput_end_us = time_us_64();
+    }
+    uint64_t bytes = goodput_bytes;
+#if TCP_STATS
+    dir->retransmits = (int32_t)(STAT_COUNTER)(lwip_stats.tcp.rexmit - rexmit_start);
+#else
+    dir->retransmits = -1;
+#endif
+    cyw43_arch_lwip_end();
+    goodput_close();
+
+    // The acknowledged upload count includes the command byte
+    if (upload && bytes > 0) {
+        bytes--;
+    }
+
+    dir->bytes = bytes;
+    dir->duration_us = (uint32_t)(goodput_end_us - goodput_start_us);
+    dir->goodput_mbps = dir->duration_us ? (bytes * 8.0f) / (float)dir->duration_us : 0.0f;
+    dir->rtt_loaded_us = replies ? (uint32_t)(rtt_sum_us / replies) : 0;
+    dir->ok = bytes > 0;
+
+    DBG("Goodput %s: %llu bytes in %lu us, %.2f Mbit/s, %ld retransmits, loaded RTT %lu us\n",
+        upload ? "up" : "down", dir->bytes, dir->duration_us, dir->goodput_mbps,
+        (long)dir->retransmits, dir->rtt_loaded_us);
+    return dir->ok;
+}
+
+/**
+ * @brief Probe the router once and accumulate the reply
+ * @param[in] deadline_us time_us_64() by which the probe must be finished
+ * @param[in,out] rtt_sum_us Sum of reply RTTs
+ * @param[in,out] replies Number of replies
+ * @note The wait is capped at PING_TIMEOUT_MS and the deadline, so a lost probe
+ * cannot stretch the transfer past GOODPUT_DURATION_MS
+ */
+static void goodput_probe(uint64_t deadline_us, uint64_t *rtt_sum_us, uint32_t *replies) {
+    uint64_t now_us = time_us_64();
+    if (now_us >= deadline_us) {
+        return;
+    }
+
+    uint64_t timeout_ms = (deadline_us - now_us) / 1000;
+    if (timeout_ms > PING_TIMEOUT_MS) {
+        timeout_ms = PING_TIMEOUT_MS;
+    }
+
+    uint32_t rtt_us;
+    if (ping_once(ROUTER_IP_ADDR, (uint32_t)timeout_ms, &rtt_us)) {
+        *rtt_sum_us += rtt_us;
+        (*replies)++;
+    }
+}
+
+/**
+ * @brief Queue upload segments until the send buffer is full
+ * @param tpcb TCP protocol control block
+ * @note Runs in lwIP context. Segments reference goodput_buf, so nothing is
+ * copied into the send buffer
+ */
+static void goodput_fill(struct tcp_pcb *tpcb) {
+    while (!goodput_stop && tcp_sndbuf(tpcb) >= sizeof(goodput_buf) &&
+           tcp_sndqueuelen(tpcb) < TCP_SND_QUEUELEN / 2) {
+        if (ERR_OK != tcp_write(tpcb, goodput_buf, sizeof(goodput_buf), TCP_WRITE_FLAG_MORE)) {
+            break;
+        }
+    }
+    tcp_output(tpcb);
+}
+
+/**
+ * @brief Abort the transfer connection
+ * @note Aborting instead of closing drops queued upload data and refuses the
+ * rest of the download, so the link is quiet right after the test
+ */
+static void goodput_close(void) {
+    cyw43_arch_lwip_begin();
+    if (NULL != goodput_pcb) {
+        tcp_arg(goodput_pcb, NULL);
+        tcp_err(goodput_pcb, NULL);
+        tcp_recv(goodput_pcb, NULL);
+        tcp_sent(goodput_pcb, NULL);
+        tcp_abort(goodput_pcb);
+        goodput_pcb = NULL;
+    }
+    cyw43_arch_lwip_end();
+}
+
+/**
+ * @brief TCP error callback for the goodput connection
+ * @param arg User provided argument (unused)
+ * @param err Error code
+ * @note lwIP has already freed the control block
+ */
+static void goodput_error_callback(void *arg, err_t err) {
+    DBG("Goodput TCP error: %d\n", err);
+    goodput_pcb = NULL;
+    if (0 == goodput_end_us) {
+        goodput_end_us = time_us_64();
+    }
+    goodput_ended = true;
+}
+
+/**
+ * @brief TCP connected callback for the goodput connection
+ * @param arg User provided argument (unused)
+ * @param tpcb TCP protocol control block
+ * @param err Error code
+ * @return ERR_OK on success
+ */
+static err_t goodput_connected_callback(void *arg, struct tcp_pcb *tpcb, err_t err) {
+    if (ERR_OK != err) {
+        DBG("Goodput connection error: %d\n", err);
+        goodput_ended = true;
+        return err;
+    }
+
+    const uint8_t *cmd = goodput_upload ? &goodput_cmd[0] : &goodput_cmd[1];
+    err_t write_err = tcp_write(tpcb, cmd, 1, 0);
+    if (ERR_OK != write_err) {
+        DBG("Goodput command write error: %d\n", write_err);
+        goodput_ended = true;
+        return write_err;
+    }
+
+    goodput_start_us = time_us_64();
+    goodput_connected = true;
+    if (goodput_upload) {
+        goodput_fill(tpcb);
+    } else {
+        tcp_output(tpcb);
+    }
+    return ERR_OK;
+}
+
+/**
+ * @brief TCP sent callback, counts acknowledged upload bytes and refills
+ * @param arg User provided argument (unused)
+ * @param tpcb TCP protocol control block
+ * @param len Number of bytes acknowledged
+ * @return ERR_OK
+ */
+static err_t goodput_sent_callback(void *arg, struct tcp_pcb *tpcb, u16_t len) {
+    if (goodput_upload && !goodput_stop) {
+        goodput_bytes += len;
+        goodput_fill(tpcb);
+    }
+    return ERR_OK;
+}
+
+/**
+ * @brief TCP receive callback, counts and discards download bytes
+ * @param arg User provided argument (unused)
+ * @param tpcb TCP protocol control block
+ * @param p Packet buffer, NULL when the sink closed the connection
+ * @param err Error code
+ * @return ERR_OK
+ */
+static err_t goodput_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    if (NULL == p) {
+        if (0 == goodput_end_us) {
+            goodput_end_us = time_us_64();
+        }
+        goodput_ended = true;
+        return ERR_OK;
+    }
+
+    if (!goodput_upload && !goodput_stop) {
+        goodput_bytes += p->tot_len;
+    }
+    tcp_recved(tpcb, p->tot_len);
+    pbuf_free(p);
+    return ERR_OK;
+}
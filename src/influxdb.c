@@ -5,6 +5,11 @@ static HTTP_Handle_t http_handle;
 static uint32_t retry_c = 0;
 static uint32_t retry_delay = INFLUX_RETRY_DELAY_MS;
 static volatile uint32_t pending_sent = 0;
+static char batch_buf[INFLUX_BATCH_BUF_SIZE];
+static size_t batch_len = 0;
+static uint16_t batch_points = 0;
+static uint64_t batch_start_us = 0;
+static bool batch_untimed = false;
 
 /* Private function prototypes -----------------------------------------------*/
 static bool send_http_post(const char *query);
@@ -12,41 +17,129 @@ static void tcp_error_callback(void *arg, err_t err);
 static err_t tcp_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
 static err_t tcp_connected_callback(void *arg, struct tcp_pcb *tpcb, err_t err);
 static err_t tcp_sent_callback(void *arg, struct tcp_pcb *tpcb, u16_t len);
+static int format_timestamp(char *buf, size_t size, uint64_t capture_us);
+static int format_measurements(char *buf, size_t size, const Influx_Measurement_t *meas);
+static int format_summary(char *buf, size_t size, const Stats_Summary_t *summary);
 
 /**
- * @brief Send Wi-Fi measurement results to InfluxDB
- * @param rtt_avg_us Average round trip time in microseconds
- * @param rtt_min_us Minimum round trip time in microseconds
- * @param rtt_max_us Maximum round trip time in microseconds
- * @param jitter_us Jitter in microseconds
- * @param loss_pct Packet loss percentage
- * @param temperature_c Temperature in Celsius
+ * @brief Queue a Wi-Fi measurement into the upload batch
+ * @param[in] meas Pointer to measurement
+ * @return true if the point was queued, false if the batch is full
+ * @note The batch is sent by `influxdb_flush()`, see `influxdb_batch_due()`
+ */
+bool influxdb_queue_measurements(const Influx_Measurement_t *meas) {
+    if (NULL == meas) {
+        DBG("Invalid measurement\n");
+        return false;
+    }
+
+    char line[384];
+    int len = format_measurements(line, sizeof(line), meas);
+    if (len <= 0 || (size_t)len >= sizeof(line)) {
+        DBG("Measurement line does not fit the buffer\n");
+        return false;
+    }
+
+    // Separator newline plus terminating null
+    if (batch_len + len + 2 > sizeof(batch_buf)) {
+        DBG("Upload batch full, dropping point\n");
+        return false;
+    }
+
+    if (0 == batch_points) {
+        batch_start_us = time_us_64();
+        batch_untimed = false;
+    } else {
+        batch_buf[batch_len++] = '\n';
+    }
+    memcpy(batch_buf + batch_len, line, len + 1);
+    batch_len += len;
+    batch_points++;
+    // Points without a timestamp must reach the server right away
+    batch_untimed |= (0 == timesync_to_unix_us(meas->capture_us));
+
+    DBG("Queued measurement (%u in batch): %s\r\n", batch_points, line);
+    return true;
+}
+
+/**
+ * @brief Check whether the upload batch should be sent now
+ * @return true if the batch is full, old enough or holds points without timestamp
+ */
+bool influxdb_batch_due(void) {
+    if (0 == batch_points) {
+        return false;
+    }
+    return batch_untimed ||
+        batch_points >= INFLUX_BATCH_MAX_POINTS ||
+        (time_us_64() - batch_start_us) >= INFLUX_BATCH_MAX_AGE_MS * 1000ULL;
+}
+
+/**
+ * @brief Send the upload batch to InfluxDB
+ * @return true on success or if the batch is empty, false otherwise
+ * @note The batch is kept on failure so the next flush retries it
+ */
+bool influxdb_flush(void) {
+    if (0 == batch_points) {
+        return true;
+    }
+
+    DBG("Sending batch of %u points to InfluxDB\r\n", batch_points);
+    if (!send_http_post(batch_buf)) {
+        return false;
+    }
+
+    batch_len = 0;
+    batch_points = 0;
+    batch_buf[0] = '\0';
+    return true;
+}
+
+/**
+ * @brief Send an anomaly-onset point immediately, ahead of the upload batch
+ * @param[in] meas Pointer to the measurement that triggered the anomaly
+ * @param[in] adaptive Pointer to the adaptive controller state
  * @return true on success, false otherwise
+ * @note Sends the measurement together with a `wifi_anomaly` line describing the
+ * detector state. On failure the caller should queue the measurement instead.
  */
-bool influxdb_send_measurements(uint64_t rtt_avg_us, uint64_t rtt_min_us, uint64_t rtt_max_us, 
-                            uint64_t jitter_us, uint8_t loss_pct, float temperature_c) {
-    char influx_query[512];
+bool influxdb_send_anomaly(const Influx_Measurement_t *meas, const Adaptive_Handle_t *adaptive) {
+    if (NULL == meas || NULL == adaptive) {
+        DBG("Invalid anomaly parameters\n");
+        return false;
+    }
 
-    snprintf(influx_query, sizeof(influx_query),
-        "wifi_measurements,host=PicoW "
-        "rtt_avg=%llu,"
-        "rtt_min=%llu,"
-        "rtt_max=%llu,"
-        "jitter=%llu,"
+    char influx_query[640];
+    char timestamp[24];
+    int len = format_measurements(influx_query, sizeof(influx_query), meas);
+    if (len <= 0 || (size_t)len >= sizeof(influx_query)) {
+        return false;
+    }
+
+    format_timestamp(timestamp, sizeof(timestamp), meas->capture_us);
+    snprintf(influx_query + len, sizeof(influx_query) - len,
+        "\nwifi_anomaly,host=PicoW,event=onset "
+        "rtt=%llu,"
+        "baseline=%.0f,"
+        "sigma=%.0f,"
+        "z=%.2f,"
         "loss=%u,"
-        "temperature=%.2f",
-        (uint64_t)rtt_avg_us,
-        (uint64_t)rtt_min_us,
-        (uint64_t)rtt_max_us,
-        (uint64_t)jitter_us,
-        loss_pct,
-        temperature_c);
-    
-        DBG("Sending measurements to InfluxDB: %s\r\n", influx_query);
-        
-        // Send the HTTP POST request to InfluxDB
-        bool request_res = send_http_post(influx_query);
-        return request_res;
+        "baseline_loss=%.3f,"
+        "interval=%lu"
+        "%s",
+        meas->failed ? 0ULL : (unsigned long long)meas->rtt_avg_us,
+        adaptive->rtt_mean_us,
+        sqrtf(adaptive->rtt_var_us2),
+        adaptive->last_z,
+        meas->loss_pct,
+        adaptive->loss_mean,
+        (unsigned long)adaptive->interval_ms,
+        timestamp);
+
+    DBG("Sending anomaly onset: %s\n", influx_query);
+    bool request_res = send_http_post(influx_query);
+    return request_res;
 }
 
 /**
@@ -258,24 +351,521 @@ static err_t tcp_sent_callback(void *arg, struct tcp_pcb *pcb, u16_t len) {
 }
 
 /**
- * @brief Send a packet with no successful pings to InfluxDB
- * @param[in] temperature_c Temperature in Celsius
+ * @brief Send Wi-Fi connection events to InfluxDB as the `wifi_events` series
+ * @param[in] events Array of connection events, oldest first
+ * @param[in] count Number of events in the array
+ * @return true on success, false otherwise
+ */
+bool influxdb_send_wifi_events(const Wifi_Event_t *events, uint16_t count) {
+    if (NULL == events || 0 == count) {
+        DBG("No Wi-Fi events to send\n");
+        return false;
+    }
+
+    char influx_query[768];
+    size_t len = 0;
+
+    for (uint16_t i = 0; i < count; i++) {
+        char timestamp[24];
+        format_timestamp(timestamp, sizeof(timestamp), events[i].timestamp_us);
+
+        int written = snprintf(influx_query + len, sizeof(influx_query) - len,
+            "%swifi_events,host=PicoW,event=%s,attempt=%u "
+            "duration=%lu,"
+            "status=%d"
+            "%s",
+            (i > 0) ? "\n" : "",
+            wifi_event_name(events[i].type),
+            events[i].attempt,
+            (unsigned long)events[i].duration_us,
+            events[i].status,
+            timestamp);
+
+        if (written < 0 || (size_t)written >= sizeof(influx_query) - len) {
+            DBG("Too many Wi-Fi events for one request (%u)\n", count);
+            return false;
+        }
+        len += written;
+    }
+
+    DBG("Sending %u Wi-Fi events to InfluxDB\n", count);
+    bool request_res = send_http_post(influx_query);
+    return request_res;
+}
+
+/**
+ * @brief Send time synchronisation status to InfluxDB as the `time_sync` series
+ * @param[in] status Pointer to synchronisation status
+ * @return true on success, false otherwise
+ */
+bool influxdb_send_timesync(const Timesync_Status_t *status) {
+    if (NULL == status || !status->synced) {
+        DBG("Clock is not synchronised\n");
+        return false;
+    }
+
+    char influx_query[160];
+    char timestamp[24];
+
+    format_timestamp(timestamp, sizeof(timestamp), status->last_sync_us);
+    snprintf(influx_query, sizeof(influx_query), "time_sync,host=PicoW "
+        "step=%lld,"
+        "drift_ppb=%ld,"
+        "syncs=%lu"
+        "%s",
+        (long long)status->step_us,
+        (long)status->drift_ppb,
+        (unsigned long)status->syncs,
+        timestamp);
+
+    DBG("Sending time sync status: %s\n", influx_query);
+    bool request_res = send_http_post(influx_query);
+    return request_res;
+}
+
+/**
+ * @brief Send stack overhead calibration result as the `ping_calibration` series
+ * @param[in] cal Pointer to calibration result
+ * @return true on success, false otherwise
+ */
+bool influxdb_send_calibration(const Ping_Calibration_t *cal) {
+    if (NULL == cal) {
+        DBG("Invalid calibration result\n");
+        return false;
+    }
+
+    char influx_query[384];
+
+    snprintf(influx_query, sizeof(influx_query), "ping_calibration,host=PicoW "
+        "tx_min=%lu,tx_median=%lu,tx_p90=%lu,tx_max=%lu,"
+        "rx_min=%lu,rx_median=%lu,rx_p90=%lu,rx_max=%lu,"
+        "samples=%u",
+        (unsigned long)cal->tx_path.min_us,
+        (unsigned long)cal->tx_path.median_us,
+        (unsigned long)cal->tx_path.p90_us,
+        (unsigned long)cal->tx_path.max_us,
+        (unsigned long)cal->rx_path.min_us,
+        (unsigned long)cal->rx_path.median_us,
+        (unsigned long)cal->rx_path.p90_us,
+        (unsigned long)cal->rx_path.max_us,
+        cal->rx_path.samples);
+
+    DBG("Sending calibration result: %s\n", influx_query);
+    bool request_res = send_http_post(influx_query);
+    return request_res;
+}
+
+/**
+ * @brief Send burst probing aggregate as the `wifi_burst` series
+ * @param[in] burst Pointer to burst result
+ * @param[in] capture_us time_us_64() when the burst started
+ * @return true on success, false otherwise
+ * @note Histogram bins are sent as `le_<edge>` fields, the last one as `le_inf`
+ */
+bool influxdb_send_burst(const Ping_Burst_t *burst, uint64_t capture_us) {
+    if (NULL == burst) {
+        DBG("Invalid burst result\n");
+        return false;
+    }
+
+    const Stats_Summary_t *summary = &burst->summary;
+    char influx_query[640];
+    char timestamp[24];
+    int len;
+
+    len = snprintf(influx_query, sizeof(influx_query), "wifi_burst,host=PicoW "
+        "rate=%u,"
+        "sent=%u,"
+        "skipped=%u,",
+        burst->rate_hz,
+        burst->sent,
+        burst->skipped);
+    if (len > 0 && (size_t)len < sizeof(influx_query)) {
+        len += format_summary(influx_query + len, sizeof(influx_query) - len, summary);
+    }
+
+    for (uint8_t i = 0; i < STATS_HIST_BINS && len > 0 && (size_t)len < sizeof(influx_query); i++) {
+        uint32_t edge = stats_bin_edge_us(i);
+        if (UINT32_MAX == edge) {
+            len += snprintf(influx_query + len, sizeof(influx_query) - len, ",le_inf=%lu",
+                (unsigned long)summary->bins[i]);
+        } else {
+            len += snprintf(influx_query + len, sizeof(influx_query) - len, ",le_%lu=%lu",
+                (unsigned long)edge, (unsigned long)summary->bins[i]);
+        }
+    }
+
+    format_timestamp(timestamp, sizeof(timestamp), capture_us);
+    if (len < 0 || (size_t)len + strlen(timestamp) >= sizeof(influx_query)) {
+        DBG("Burst query does not fit the buffer\n");
+        return false;
+    }
+    strcat(influx_query, timestamp);
+
+    DBG("Sending burst aggregate: %s\n", influx_query);
+    bool request_res = send_http_post(influx_query);
+    return request_res;
+}
+
+/**
+ * @brief Send payload-size sweep and packet-train results as the `wifi_capacity` series
+ * @param[in] sweep Sweep result, NULL if the sweep failed
+ * @param[in] train Train result, NULL if the trains failed
+ * @param[in] capture_us time_us_64() when probing started
+ * @return true on success, false otherwise
+ */
+bool influxdb_send_capacity(const Ping_Sweep_t *sweep, const Ping_Train_t *train, uint64_t capture_us) {
+    if (NULL == sweep && NULL == train) {
+        DBG("Invalid capacity result\n");
+        return false;
+    }
+
+    char influx_query[384];
+    char timestamp[24];
+    int len;
+    const char *sep = "";
+
+    len = snprintf(influx_query, sizeof(influx_query), "wifi_capacity,host=PicoW ");
+
+    if (NULL != sweep) {
+        // Request and reply both carry the payload, 16 bits per byte of slope
+        float sweep_mbps = (sweep->slope_ns_per_byte > 0.0f) ? 16000.0f / sweep->slope_ns_per_byte : 0.0f;
+        len += snprintf(influx_query + len, sizeof(influx_query) - len,
+            "slope_ns_per_byte=%.2f,"
+            "intercept=%.1f,"
+            "sweep_mbps=%.2f,"
+            "sweep_steps=%u",
+            sweep->slope_ns_per_byte,
+            sweep->intercept_us,
+            sweep_mbps,
+            sweep->valid_steps);
+        for (int i = 0; i < PING_SWEEP_STEPS && len > 0 && (size_t)len < sizeof(influx_query); i++) {
+            if (0 != sweep->min_rtt_us[i]) {
+                len += snprintf(influx_query + len, sizeof(influx_query) - len, ",rtt_%u=%lu",
+                    sweep->payload[i], (unsigned long)sweep->min_rtt_us[i]);
+            }
+        }
+        sep = ",";
+    }
+
+    if (NULL != train && len > 0 && (size_t)len < sizeof(influx_query)) {
+        len += snprintf(influx_query + len, sizeof(influx_query) - len,
+            "%s"
+            "train_sent=%u,"
+            "train_received=%u,"
+            "packet_bytes=%u,"
+            "dispersion=%lu,"
+            "capacity_mbps=%.2f",
+            sep,
+            train->sent,
+            train->received,
+            train->packet_bytes,
+            (unsigned long)train->dispersion_us,
+            train->capacity_mbps);
+    }
+
+    format_timestamp(timestamp, sizeof(timestamp), capture_us);
+    if (len < 0 || (size_t)len + strlen(timestamp) >= sizeof(influx_query)) {
+        DBG("Capacity query does not fit the buffer\n");
+        return false;
+    }
+    strcat(influx_query, timestamp);
+
+    DBG("Sending capacity estimate: %s\n", influx_query);
+    bool request_res = send_http_post(influx_query);
+    return request_res;
+}
+
+/**
+ * @brief Send per access category results as the `wifi_qos` series, one point per class
+ * @param[in] qos Per access category probe result
+ * @param[in] load Load tag: "idle", or the goodput direction ("up", "down") the probes ran under
+ * @param[in] capture_us time_us_64() when probing started
  * @return true on success, false otherwise
  */
-bool influxdb_send_failure(float temperature_c) {
-    char influx_query[128];
+bool influxdb_send_qos(const Ping_Qos_t *qos, const char *load, uint64_t capture_us) {
+    if (NULL == qos || NULL == load) {
+        DBG("Invalid QoS result\n");
+        return false;
+    }
 
-    snprintf(influx_query, sizeof(influx_query), "wifi_measurements,host=PicoW "
-        "loss=100,"
-        "temperature=%.2f",
-        temperature_c);
+    static char influx_query[1024];
+    char timestamp[24];
+    int len = 0;
+
+    format_timestamp(timestamp, sizeof(timestamp), capture_us);
+
+    for (int ac = 0; ac < PING_AC_COUNT && len >= 0 && (size_t)len < sizeof(influx_query); ac++) {
+        const Stats_Summary_t *summary = &qos->summary[ac];
+        len += snprintf(influx_query + len, sizeof(influx_query) - len,
+            "%swifi_qos,host=PicoW,ac=%s,load=%s "
+            "dscp=%u,",
+            (len > 0) ? "\n" : "",
+            ping_ac_name((Ping_AccessCategory_t)ac),
+            load,
+            qos->dscp[ac]);
+        if (len > 0 && (size_t)len < sizeof(influx_query)) {
+            len += format_summary(influx_query + len, sizeof(influx_query) - len, summary);
+        }
+        if (len > 0 && (size_t)len < sizeof(influx_query)) {
+            len += snprintf(influx_query + len, sizeof(influx_query) - len, "%s", timestamp);
+        }
+    }
+
+    if (len <= 0 || (size_t)len >= sizeof(influx_query)) {
+        DBG("QoS query does not fit the buffer\n");
+        return false;
+    }
 
-    // Send the HTTP POST request to InfluxDB
-    DBG("Sending failure query anyway: %s\n", influx_query);
+    DBG("Sending QoS results: %s\n", influx_query);
     bool request_res = send_http_post(influx_query);
     return request_res;
 }
 
+/**
+ * @brief Send a goodput test result as the `wifi_goodput` series, one point per direction
+ * @param[in] result Goodput test result
+ * @param[in] capture_us time_us_64() when the test started
+ * @return true on success, false otherwise
+ */
+bool influxdb_send_goodput(const Goodput_Result_t *result, uint64_t capture_us) {
+    if (NULL == result || (!result->up.ok && !result->down.ok)) {
+        DBG("Invalid goodput result\n");
+        return false;
+    }
+
+    const Goodput_Direction_t *dirs[2] = { &result->up, &result->down };
+    const char *names[2] = { "up", "down" };
+    char influx_query[512];
+    char timestamp[24];
+    int len = 0;
+
+    format_timestamp(timestamp, sizeof(timestamp), capture_us);
+
+    for (int i = 0; i < 2; i++) {
+        const Goodput_Direction_t *dir = dirs[i];
+        if (!dir->ok || len < 0 || (size_t)len >= sizeof(influx_query)) {
+            continue;
+        }
+
+        len += snprintf(influx_query + len, sizeof(influx_query) - len,
+            "%swifi_goodput,host=PicoW,direction=%s "
+            "bytes=%llu,"
+            "duration=%lu,"
+            "goodput_mbps=%.2f,"
+            "rtt_idle=%lu,"
+            "rtt_loaded=%lu",
+            (len > 0) ? "\n" : "",
+            names[i],
+            (unsigned long long)dir->bytes,
+            (unsigned long)dir->duration_us,
+            dir->goodput_mbps,
+            (unsigned long)result->rtt_idle_us,
+            (unsigned long)dir->rtt_loaded_us);
+
+        // Queueing delay added by the transfer
+        if (result->rtt_idle_us > 0 && dir->rtt_loaded_us > 0 && len > 0 && (size_t)len < sizeof(influx_query)) {
+            len += snprintf(influx_query + len, sizeof(influx_query) - len, ",bufferbloat=%ld",
+                (long)dir->rtt_loaded_us - (long)result->rtt_idle_us);
+        }
+        if (dir->retransmits >= 0 && len > 0 && (size_t)len < sizeof(influx_query)) {
+            len += snprintf(influx_query + len, sizeof(influx_query) - len, ",retransmits=%ld",
+                (long)dir->retransmits);
+        }
+        if (len > 0 && (size_t)len < sizeof(influx_query)) {
+            len += snprintf(influx_query + len, sizeof(influx_query) - len, "%s", timestamp);
+        }
+    }
+
+    if (len <= 0 || (size_t)len >= sizeof(influx_query)) {
+        DBG("Goodput query does not fit the buffer\n");
+        return false;
+    }
+
+    DBG("Sending goodput result: %s\n", influx_query);
+    bool request_res = send_http_post(influx_query);
+    return request_res;
+}
+
+/**
+ * @brief Send a sliding-window aggregate as the `wifi_windows` series
+ * @param[in] window Window name used as the `window` tag, e.g. "5m"
+ * @param[in] summary Window summary, see `stats_window_get()`
+ * @param[in] capture_us time_us_64() at the end of the window
+ * @return true on success, false otherwise
+ */
+bool influxdb_send_window(const char *window, const Stats_Summary_t *summary, uint64_t capture_us) {
+    if (NULL == window || NULL == summary) {
+        DBG("Invalid window aggregate\n");
+        return false;
+    }
+
+    char influx_query[320];
+    char timestamp[24];
+    int len;
+
+    len = snprintf(influx_query, sizeof(influx_query), "wifi_windows,host=PicoW,window=%s ", window);
+    if (len > 0 && (size_t)len < sizeof(influx_query)) {
+        len += format_summary(influx_query + len, sizeof(influx_query) - len, summary);
+    }
+
+    format_timestamp(timestamp, sizeof(timestamp), capture_us);
+    if (len < 0 || (size_t)len + strlen(timestamp) >= sizeof(influx_query)) {
+        DBG("Window query does not fit the buffer\n");
+        return false;
+    }
+    strcat(influx_query, timestamp);
+
+    DBG("Sending window aggregate: %s\n", influx_query);
+    bool request_res = send_http_post(influx_query);
+    return request_res;
+}
+
+/**
+ * @brief Send the latency summary of one power management window as the `wifi_pm` series
+ * @param[in] mode Power management profile name
+ * @param[in] pm_value Value passed to cyw43_wifi_pm()
+ * @param[in] summary RTT summary of the window
+ * @param[in] cycles Measurement cycles in the summary
+ * @param[in] capture_us time_us_64() when the window started
+ * @return true on success, false otherwise
+ */
+bool influxdb_send_power_mode(const char *mode, uint32_t pm_value, const Stats_Summary_t *summary,
+                              uint32_t cycles, uint64_t capture_us) {
+    if (NULL == mode || NULL == summary) {
+        DBG("Invalid power mode summary\n");
+        return false;
+    }
+
+    char influx_query[384];
+    char timestamp[24];
+    int len;
+
+    len = snprintf(influx_query, sizeof(influx_query), "wifi_pm,host=PicoW,pm=%s "
+        "pm_value=%lu,"
+        "cycles=%lu,",
+        mode,
+        (unsigned long)pm_value,
+        (unsigned long)cycles);
+    if (len > 0 && (size_t)len < sizeof(influx_query)) {
+        len += format_summary(influx_query + len, sizeof(influx_query) - len, summary);
+    }
+
+    format_timestamp(timestamp, sizeof(timestamp), capture_us);
+    if (len < 0 || (size_t)len + strlen(timestamp) >= sizeof(influx_query)) {
+        DBG("Power mode query does not fit the buffer\n");
+        return false;
+    }
+    strcat(influx_query, timestamp);
+
+    DBG("Sending power mode summary: %s\n", influx_query);
+    bool request_res = send_http_post(influx_query);
+    return request_res;
+}
+
+/**
+ * @brief Send a compressed per-packet trace block as the `wifi_trace` series
+ * @param[in] block Encoded block, see `trace_encode_block()`
+ * @param[in] len Block length in bytes
+ * @param[in] records Number of records in the block
+ * @param[in] first_seq Sequence number of the first record
+ * @param[in] capture_us time_us_64() send time of the first record
+ * @return true on success, false otherwise
+ * @note The block is carried base64 encoded in the `block` string field and is
+ * decoded on the host with tools/trace_decode
+ */
+bool influxdb_send_trace(const uint8_t *block, size_t len, uint16_t records,
+                        uint16_t first_seq, uint64_t capture_us) {
+    if (NULL == block || 0 == len) {
+        DBG("Invalid trace block\n");
+        return false;
+    }
+
+    // Kept off the stack, the encoded block alone is larger than the other queries
+    static char encoded[4 * ((TRACE_BLOCK_BYTES + 2) / 3) + 1];
+    static char influx_query[sizeof(encoded) + 160];
+    char timestamp[24];
+
+    if (0 == trace_base64(block, len, encoded, sizeof(encoded))) {
+        DBG("Trace block too large (%u bytes)\n", (unsigned)len);
+        return false;
+    }
+
+    format_timestamp(timestamp, sizeof(timestamp), capture_us);
+    snprintf(influx_query, sizeof(influx_query), "wifi_trace,host=PicoW "
+        "records=%u,"
+        "first_seq=%u,"
+        "bytes=%u,"
+        "dropped=%lu,"
+        "block=\"%s\""
+        "%s",
+        records,
+        first_seq,
+        (unsigned)len,
+        (unsigned long)trace_dropped_count(),
+        encoded,
+        timestamp);
+
+    DBG("Sending trace block: %u records in %u bytes\n", records, (unsigned)len);
+    bool request_res = send_http_post(influx_query);
+    return request_res;
+}
+
+/**
+ * @brief Format a measurement as a `wifi_measurements` line
+ * @param[out] buf Destination buffer
+ * @param[in] size Size of the destination buffer
+ * @param[in] meas Pointer to measurement
+ * @return Number of characters that would have been written, see snprintf()
+ */
+static int format_measurements(char *buf, size_t size, const Influx_Measurement_t *meas) {
+    return lineproto_format_measurements(buf, size, meas, timesync_to_unix_us(meas->capture_us));
+}
+
+/**
+ * @brief Format the RTT summary fields shared by the aggregate series
+ * @param[out] buf Destination buffer
+ * @param[in] size Size of the destination buffer
+ * @param[in] summary RTT summary
+ * @return Number of characters that would have been written, see snprintf()
+ */
+static int format_summary(char *buf, size_t size, const Stats_Summary_t *summary) {
+    return snprintf(buf, size,
+        "count=%lu,"
+        "lost=%lu,"
+        "loss=%.2f,"
+        "rtt_min=%lu,"
+        "rtt_max=%lu,"
+        "rtt_mean=%lu,"
+        "rtt_stddev=%lu,"
+        "rtt_p50=%lu,"
+        "rtt_p90=%lu,"
+        "rtt_p99=%lu",
+        (unsigned long)summary->count,
+        (unsigned long)summary->lost,
+        stats_loss_pct(summary),
+        (unsigned long)((summary->count > 0) ? summary->min_us : 0),
+        (unsigned long)summary->max_us,
+        (unsigned long)stats_mean_us(summary),
+        (unsigned long)stats_stddev_us(summary),
+        (unsigned long)stats_percentile_us(summary, 50),
+        (unsigned long)stats_percentile_us(summary, 90),
+        (unsigned long)stats_percentile_us(summary, 99));
+}
+
+/**
+ * @brief Format the line protocol timestamp for a capture time
+ * @param[out] buf Destination buffer
+ * @param[in] size Size of the destination buffer
+ * @param[in] capture_us time_us_64() when the point was captured
+ * @return Number of characters written
+ * @note Writes an empty string while the clock is not synchronised, so the
+ * server stamps the point on arrival
+ */
+static int format_timestamp(char *buf, size_t size, uint64_t capture_us) {
+    return lineproto_format_timestamp(buf, size, timesync_to_unix_us(capture_us));
+}
+
 /**
  * @brief Calculate delay for retrying failed operations
  * @param retry_count Pointer to retry counter
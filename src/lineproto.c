@@ -0,0 +1,73 @@
+#include "lineproto.h"
+
+/**
+ * @brief Format the line protocol timestamp
+ * @param[out] buf Destination buffer
+ * @param[in] size Size of the destination buffer
+ * @param[in] unix_us Unix time in microseconds, 0 if the clock is not synchronised
+ * @return Number of characters written
+ * @note Writes an empty string for unix_us 0, so the server stamps the point on arrival
+ */
+int lineproto_format_timestamp(char *buf, size_t size, uint64_t unix_us) {
+    if (0 == unix_us) {
+        buf[0] = '\0';
+        return 0;
+    }
+    // Request precision is ms
+    return snprintf(buf, size, " %" PRIu64, unix_us / 1000);
+}
+
+/**
+ * @brief Format a measurement as a `wifi_measurements` line
+ * @param[out] buf Destination buffer
+ * @param[in] size Size of the destination buffer
+ * @param[in] meas Pointer to measurement
+ * @param[in] unix_us Unix capture time in microseconds, 0 if unknown
+ * @return Number of characters that would have been written, see snprintf()
+ * @note `rtt_*` fields are raw, `rtt_*_corr` have each reply's measured send and
+ * receive path cost subtracted. The `pm_mode` tag is only written when set.
+ * Failed cycles only carry loss and temperature.
+ */
+int lineproto_format_measurements(char *buf, size_t size, const Influx_Measurement_t *meas, uint64_t unix_us) {
+    char timestamp[24];
+    char tags[32] = "";
+
+    lineproto_format_timestamp(timestamp, sizeof(timestamp), unix_us);
+    if (NULL != meas->pm_mode) {
+        snprintf(tags, sizeof(tags), ",pm_mode=%s", meas->pm_mode);
+    }
+
+    if (meas->failed) {
+        return snprintf(buf, size, "wifi_measurements,host=PicoW%s "
+            "loss=100,"
+            "temperature=%.2f"
+            "%s",
+            tags,
+            meas->temperature_c,
+            timestamp);
+    }
+
+    return snprintf(buf, size,
+        "wifi_measurements,host=PicoW%s "
+        "rtt_avg=%" PRIu64 ","
+        "rtt_min=%" PRIu64 ","
+        "rtt_max=%" PRIu64 ","
+        "jitter=%" PRIu64 ","
+        "loss=%u,"
+        "temperature=%.2f,"
+        "rtt_avg_corr=%" PRIu64 ","
+        "rtt_min_corr=%" PRIu64 ","
+        "rtt_max_corr=%" PRIu64
+        "%s",
+        tags,
+        meas->rtt_avg_us,
+        meas->rtt_min_us,
+        meas->rtt_max_us,
+        meas->jitter_us,
+        meas->loss_pct,
+        meas->temperature_c,
+        meas->rtt_avg_corr_us,
+        meas->rtt_min_corr_us,
+        meas->rtt_max_corr_us,
+        timestamp);
+}
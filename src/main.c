@@ -8,9 +8,48 @@
 #include "ping.h"
 #include "wifi.h"
 #include "influxdb.h"
+#include "timesync.h"
+#include "adaptive.h"
+#include "goodput.h"
 
 #define MAX_WIFI_REINIT_TRIES    100
 
+/**
+ * @brief Sliding window definition
+ */
+typedef struct {
+    const char *name;       // Window tag
+    uint32_t bucket_ms;     // Bucket width
+    uint8_t buckets;        // Number of buckets
+} Window_Config_t;
+
+/* Private variables ---------------------------------------------------------*/
+static const Window_Config_t window_config[] = {
+    { "1m",  10000,  6 },
+    { "5m",  30000, 10 },
+    { "15m", 60000, 15 },
+};
+#define WINDOW_COUNT (sizeof(window_config) / sizeof(window_config[0]))
+static Stats_Window_t windows[WINDOW_COUNT];
+// Power management A/B window
+static Stats_Summary_t pm_summary;
+static uint64_t pm_start_us = 0;
+static uint32_t pm_cycles = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+static void upload_wifi_events(void);
+static void upload_timesync(void);
+static void calibrate_ping(void);
+static void run_burst(void);
+static void run_capacity_probe(void);
+static void run_goodput(void);
+static void run_qos(void);
+static void upload_trace(void);
+static void windows_init(void);
+static void windows_add(const Ping_Handle_t *ping);
+static void upload_windows(void);
+static bool pm_ab_update(const Ping_Handle_t *ping);
+
 /**
  * @brief  The application entry point.
  * @return int
@@ -30,49 +69,117 @@ int main()
         printf("Fatal: Wi-Fi init failed, halting.\r\n");
         while (true) tight_loop_contents();
     }
+    if (!ping_init()) {
+        printf("Ping init failed\r\n");
+    }
+    timesync_start();
+    calibrate_ping();
+    windows_init();
 
     uint32_t retry_c = 0;
     bool wifi_reinit_success = false;
     uint32_t retry_delay = INITIAL_RETRY_DELAY_MS;
+    uint32_t cycle = 0;
+    Adaptive_Handle_t adaptive;
+    adaptive_init(&adaptive);
+    stats_reset(&pm_summary);
 
     while (true) {
         Ping_Handle_t ping;
+        Influx_Measurement_t meas = { 0 };
+        // Points are stamped with the time the probes were sent
+        meas.capture_us = time_us_64();
+        if (WIFI_PM_AB_ENABLE) {
+            meas.pm_mode = wifi_power_mode_name(wifi_get_power_mode());
+        }
         bool ping_ok = ping_measure(&ping, ROUTER_IP_ADDR);
 
-        float temperature = temperature_read_celsius();
-        printf("\r\nTemperature: %.2f°C\r\n", temperature);
+        meas.temperature_c = temperature_read_celsius();
+        printf("\r\nTemperature: %.2f°C\r\n", meas.temperature_c);
+
+        // Cycles with every probe lost are losses, not gaps
+        if (ping.sent > 0) {
+            windows_add(&ping);
+        }
 
-        if (ping_ok && ping.received > 0) {
-            uint64_t avg, min, max, jit;
-            uint8_t loss;
-            ping_calculate_stats(&ping, &avg, &min, &max, &jit, &loss);
+        if (ping_ok) {
+            ping_calculate_stats(&ping, &meas.rtt_avg_us, &meas.rtt_min_us, &meas.rtt_max_us,
+                                 &meas.jitter_us, &meas.loss_pct);
+            ping_corrected_stats(&ping, &meas.rtt_avg_corr_us, &meas.rtt_min_corr_us,
+                                 &meas.rtt_max_corr_us);
 
             DBG("Packets: sent=%u, received=%u, loss=%u%%\r\n",
-                ping.sent, ping.received, loss);
+                ping.sent, ping.received, meas.loss_pct);
             DBG("RTT: avg=%llu us, min=%llu us, max=%llu us, jitter=%llu us\r\n",
-                avg, min, max, jit);
+                meas.rtt_avg_us, meas.rtt_min_us, meas.rtt_max_us, meas.jitter_us);
+            DBG("Corrected RTT: avg=%llu us, min=%llu us, max=%llu us\r\n",
+                meas.rtt_avg_corr_us, meas.rtt_min_corr_us, meas.rtt_max_corr_us);
+        } else {
+            DBG("Ping measurement failed\r\n");
+            meas.failed = true;
+            meas.loss_pct = 100;
+        }
 
-            if (influxdb_send_measurements(avg, min, max, jit, loss, temperature)) {
-                retry_c	= 0;
-                retry_delay = INITIAL_RETRY_DELAY_MS;
-            } else {
-                DBG("Failed to send data to InfluxDB\r\n");
-                retry_delay = calculate_backoff_delay(&retry_c, &retry_delay);
+        // Anomaly-onset points skip the batch and go out right away
+        Adaptive_Event_t event = ADAPTIVE_EVENT_NONE;
+        if (ADAPTIVE_ENABLE) {
+            event = adaptive_update(&adaptive, !meas.failed, meas.rtt_avg_us, meas.loss_pct);
+        }
+        if (ADAPTIVE_EVENT_ONSET == event) {
+            printf("Anomaly detected, probing every %lu ms\r\n", adaptive_interval_ms(&adaptive));
+            if (!influxdb_send_anomaly(&meas, &adaptive)) {
+                DBG("Failed to send anomaly onset, queueing it\r\n");
+                influxdb_queue_measurements(&meas);
             }
         } else {
-            DBG("Ping measurement failed\r\n");
-            if (influxdb_send_failure(temperature)) {
+            if (ADAPTIVE_EVENT_END == event) {
+                printf("Anomaly over, back to %u ms interval\r\n", MEASUREMENT_INTERVAL_MS);
+            }
+            influxdb_queue_measurements(&meas);
+        }
+
+        // Flush on schedule, and right after an onset so the context before it follows
+        if (influxdb_batch_due() || ADAPTIVE_EVENT_ONSET == event) {
+            if (influxdb_flush()) {
                 retry_c	= 0;
                 retry_delay = INITIAL_RETRY_DELAY_MS;
             } else {
-                DBG("Failed to send failure report to InfluxDB\r\n");
+                DBG("Failed to send data to InfluxDB\r\n");
                 retry_delay = calculate_backoff_delay(&retry_c, &retry_delay);
             }
         }
 
+        // Rotate through the power management profiles, each profile has its own baseline
+        if (WIFI_PM_AB_ENABLE && pm_ab_update(&ping)) {
+            adaptive_init(&adaptive);
+        }
+
+        // Periodic high-rate burst to catch sub-second outages and spikes
+        ++cycle;
+        if (PING_BURST_ENABLE && (cycle % PING_BURST_EVERY_N_CYCLES) == 0) {
+            run_burst();
+        }
+
+        // DSCP-marked probes per WMM access category
+        if (QOS_ENABLE && (cycle % QOS_EVERY_N_CYCLES) == 0) {
+            run_qos();
+        }
+
+        // Occasional payload sweep and packet trains for link capacity
+        if (PING_CAPACITY_ENABLE && (cycle % PING_CAPACITY_EVERY_N_CYCLES) == 0) {
+            run_capacity_probe();
+        }
+
+        // Scheduled bulk transfer against the goodput sink
+        if (GOODPUT_ENABLE && (cycle % GOODPUT_EVERY_N_CYCLES) == 0) {
+            run_goodput();
+        }
+
         // Check if Wi-Fi is still working
          if (!wifi_is_connected()) {
             printf("Wi-Fi link down! Reinitializing…\r\n");
+             timesync_stop();
+             ping_deinit();
              wifi_deinit();
             
 
@@ -82,6 +189,12 @@ int main()
                 sleep_ms(backoff);
                 if (wifi_init()) {
                     printf("Wi-Fi back online after %u retries\r\n", i + 1);
+                    if (!ping_init()) {
+                        printf("Ping init failed\r\n");
+                    }
+                    timesync_start();
+                    // lwIP was re-initialized, stack timing may have changed
+                    calibrate_ping();
                     reinit_ok = true;
                     break;
                 }
@@ -94,8 +207,285 @@ int main()
             }
         }
 
+        // Upload connection events recorded during boot or the last outage
+        upload_wifi_events();
+        upload_timesync();
+        if (TRACE_ENABLE) {
+            upload_trace();
+        }
+        upload_windows();
+
         wifi_process();
-        sleep_ms(MEASUREMENT_INTERVAL_MS);
+        sleep_ms(ADAPTIVE_ENABLE ? adaptive_interval_ms(&adaptive) : MEASUREMENT_INTERVAL_MS);
     }
     return 0;
 }
+
+/**
+ * @brief Upload pending Wi-Fi connection events to InfluxDB
+ * @note Events that fail to upload stay in the log and are retried next cycle
+ */
+static void upload_wifi_events(void) {
+    Wifi_Event_t events[WIFI_EVENTS_PER_UPLOAD];
+    uint16_t count;
+
+    while ((count = wifi_events_peek(events, WIFI_EVENTS_PER_UPLOAD)) > 0) {
+        if (!influxdb_send_wifi_events(events, count)) {
+            DBG("Failed to send Wi-Fi events to InfluxDB\r\n");
+            break;
+        }
+        wifi_events_consume(count);
+    }
+}
+
+/**
+ * @brief Upload clock offset and drift after every new SNTP sync
+ */
+static void upload_timesync(void) {
+    static uint32_t uploaded_syncs = 0;
+    Timesync_Status_t status;
+
+    timesync_get_status(&status);
+    if (!status.synced || status.syncs == uploaded_syncs) {
+        return;
+    }
+
+    DBG("Clock sync #%lu: step=%lld us, drift=%ld ppb\r\n",
+        (unsigned long)status.syncs, (long long)status.step_us, (long)status.drift_ppb);
+    if (influxdb_send_timesync(&status)) {
+        uploaded_syncs = status.syncs;
+    } else {
+        DBG("Failed to send time sync status to InfluxDB\r\n");
+    }
+}
+
+/**
+ * @brief Measure the device-side stack cost and upload the result
+ * @note On failure the previous estimate stays in effect
+ */
+static void calibrate_ping(void) {
+    Ping_Calibration_t cal;
+
+    if (!ping_calibrate(&cal, ROUTER_IP_ADDR)) {
+        DBG("Ping calibration failed\r\n");
+        return;
+    }
+    if (!influxdb_send_calibration(&cal)) {
+        DBG("Failed to send calibration result to InfluxDB\r\n");
+    }
+}
+
+/**
+ * @brief Run a probe burst and upload its aggregate
+ */
+static void run_burst(void) {
+    Ping_Burst_t burst;
+    uint64_t capture_us = time_us_64();
+
+    if (!ping_burst(&burst, ROUTER_IP_ADDR) && 0 == burst.sent) {
+        DBG("Burst probing failed\r\n");
+        return;
+    }
+    // A burst with replies missing is still reported, loss is the point of it
+    if (!influxdb_send_burst(&burst, capture_us)) {
+        DBG("Failed to send burst aggregate to InfluxDB\r\n");
+    }
+}
+
+/**
+ * @brief Run the payload-size sweep and packet trains and upload the estimate
+ */
+static void run_capacity_probe(void) {
+    Ping_Sweep_t sweep;
+    Ping_Train_t train;
+    uint64_t capture_us = time_us_64();
+
+    bool sweep_ok = ping_sweep(&sweep, ROUTER_IP_ADDR);
+    bool train_ok = ping_train(&train, ROUTER_IP_ADDR);
+    if (!sweep_ok && !train_ok) {
+        DBG("Capacity probing failed\r\n");
+        return;
+    }
+    if (!influxdb_send_capacity(sweep_ok ? &sweep : NULL, train_ok ? &train : NULL, capture_us)) {
+        DBG("Failed to send capacity estimate to InfluxDB\r\n");
+    }
+}
+
+/**
+ * @brief Probe every WMM access category and upload the per-class results
+ */
+static void run_qos(void) {
+    Ping_Qos_t qos;
+    uint64_t capture_us = time_us_64();
+
+    if (!ping_qos(&qos, ROUTER_IP_ADDR, 0)) {
+        DBG("QoS probing failed\r\n");
+        return;
+    }
+    if (!influxdb_send_qos(&qos, "idle", capture_us)) {
+        DBG("Failed to send QoS results to InfluxDB\r\n");
+    }
+}
+
+/**
+ * @brief Run the goodput test and upload the result
+ */
+static void run_goodput(void) {
+    // Per access category summaries make the result too large for the stack
+    static Goodput_Result_t result;
+    uint64_t capture_us = time_us_64();
+
+    if (!goodput_run(&result)) {
+        DBG("Goodput test failed\r\n");
+        return;
+    }
+    if (!influxdb_send_goodput(&result, capture_us)) {
+        DBG("Failed to send goodput result to InfluxDB\r\n");
+    }
+    if (result.up.qos_ok && !influxdb_send_qos(&result.up.qos, "up", capture_us)) {
+        DBG("Failed to send loaded QoS results to InfluxDB\r\n");
+    }
+    if (result.down.qos_ok && !influxdb_send_qos(&result.down.qos, "down", capture_us)) {
+        DBG("Failed to send loaded QoS results to InfluxDB\r\n");
+    }
+}
+
+/**
+ * @brief Upload full per-packet trace blocks
+ * @note Records that fail to upload stay in the ring and are retried next cycle,
+ * the ring overwrites the oldest records if the upload path stays down
+ */
+static void upload_trace(void) {
+    static uint8_t block[TRACE_BLOCK_BYTES];
+
+    while (trace_pending() >= TRACE_BLOCK_RECORDS) {
+        Trace_Record_t first;
+        uint16_t records = 0;
+        size_t len = 0;
+
+        // Probe callbacks append to the ring from lwIP context
+        cyw43_arch_lwip_begin();
+        bool have_first = trace_peek(&first);
+        cyw43_arch_lwip_end();
+        if (!have_first) {
+            break;
+        }
+
+        uint64_t base_us = timesync_to_unix_us(first.tx_us);
+        cyw43_arch_lwip_begin();
+        len = trace_encode_block(block, sizeof(block),
+                                 base_us ? base_us : first.tx_us, base_us != 0, &records);
+        cyw43_arch_lwip_end();
+
+        if (0 == len) {
+            break;
+        }
+        if (!influxdb_send_trace(block, len, records, first.seq, first.tx_us)) {
+            DBG("Failed to send trace block to InfluxDB\r\n");
+            break;
+        }
+
+        cyw43_arch_lwip_begin();
+        trace_consume(records);
+        cyw43_arch_lwip_end();
+    }
+}
+
+/**
+ * @brief Set up the sliding windows
+ */
+static void windows_init(void) {
+    uint64_t now_us = time_us_64();
+
+    for (size_t i = 0; i < WINDOW_COUNT; i++) {
+        stats_window_init(&windows[i], window_config[i].bucket_ms, window_config[i].buckets, now_us);
+    }
+}
+
+/**
+ * @brief Add the probes of one measurement cycle to all sliding windows
+ * @param ping Completed ping measurement
+ */
+static void windows_add(const Ping_Handle_t *ping) {
+    uint64_t now_us = time_us_64();
+
+    for (size_t i = 0; i < WINDOW_COUNT; i++) {
+        for (uint16_t j = 0; j < ping->received; j++) {
+            stats_window_add(&windows[i], now_us, (uint32_t)ping->rtt_us[j]);
+        }
+        for (uint16_t j = ping->received; j < ping->sent; j++) {
+            stats_window_add_loss(&windows[i], now_us);
+        }
+    }
+}
+
+/**
+ * @brief Upload the sliding-window aggregates every WINDOW_EXPORT_INTERVAL_MS
+ * @note A failed upload is retried next cycle with the then-current windows
+ */
+static void upload_windows(void) {
+    static uint64_t last_export_us = 0;
+    uint64_t now_us = time_us_64();
+
+    if (now_us - last_export_us < WINDOW_EXPORT_INTERVAL_MS * 1000ULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < WINDOW_COUNT; i++) {
+        const Stats_Summary_t *summary = stats_window_get(&windows[i], now_us);
+        if (0 == summary->count && 0 == summary->lost) {
+            continue;
+        }
+        if (!influxdb_send_window(window_config[i].name, summary, now_us)) {
+            DBG("Failed to send %s window to InfluxDB\r\n", window_config[i].name);
+            return;
+        }
+    }
+    last_export_us = now_us;
+}
+
+/**
+ * @brief Add one measurement cycle to the power management A/B window
+ * @param ping Ping measurement of the cycle, fully lost cycles included
+ * @return true if the window ended and the next profile was applied, false otherwise
+ * @note The first WIFI_PM_AB_SETTLE_CYCLES cycles after a switch are not counted,
+ * the radio is still leaving the previous profile's sleep state
+ */
+static bool pm_ab_update(const Ping_Handle_t *ping) {
+    pm_cycles++;
+    if (pm_cycles <= WIFI_PM_AB_SETTLE_CYCLES) {
+        return false;
+    }
+
+    if (0 == pm_start_us) {
+        pm_start_us = time_us_64();
+    }
+    // Cycles with every probe lost are the power-save stalls this mode measures
+    for (uint16_t i = 0; i < ping->received; i++) {
+        stats_add(&pm_summary, (uint32_t)ping->rtt_us[i]);
+    }
+    for (uint16_t i = ping->received; i < ping->sent; i++) {
+        stats_add_loss(&pm_summary);
+    }
+
+    if (pm_cycles < WIFI_PM_AB_SETTLE_CYCLES + WIFI_PM_AB_WINDOW_CYCLES) {
+        return false;
+    }
+
+    Wifi_PowerMode_t mode = wifi_get_power_mode();
+    printf("Power mode %s: mean RTT %lu us, loss %.2f%%\r\n", wifi_power_mode_name(mode),
+           stats_mean_us(&pm_summary), stats_loss_pct(&pm_summary));
+    if (!influxdb_send_power_mode(wifi_power_mode_name(mode), wifi_power_mode_value(mode), &pm_summary,
+                                  pm_cycles - WIFI_PM_AB_SETTLE_CYCLES, pm_start_us)) {
+        DBG("Failed to send power mode summary to InfluxDB\r\n");
+    }
+
+    Wifi_PowerMode_t next = (Wifi_PowerMode_t)((mode + 1) % WIFI_PM_COUNT);
+    if (!wifi_set_power_mode(next)) {
+        DBG("Staying in power mode %s\r\n", wifi_power_mode_name(mode));
+    }
+    stats_reset(&pm_summary);
+    pm_start_us = 0;
+    pm_cycles = 0;
+    return true;
+}
@@ -1,20 +1,171 @@
 #include "ping.h"
 
+// Every in-flight burst probe may hold a pool pbuf for its reply, keep most of
+// the pool available for the upload path
+_Static_assert(PING_BURST_MAX_INFLIGHT <= PBUF_POOL_SIZE / 4, "Burst in-flight limit too large for PBUF_POOL_SIZE");
+_Static_assert((PING_BURST_MAX_INFLIGHT & (PING_BURST_MAX_INFLIGHT - 1)) == 0, "PING_BURST_MAX_INFLIGHT must be a power of two");
+_Static_assert(PING_TX_POOL_SIZE > 0 && PING_TX_POOL_SIZE <= 255, "PING_TX_POOL_SIZE out of range");
+// Replies are parsed from a single pool pbuf
+_Static_assert(IP_HLEN + sizeof(ICMP_EchoHeader_t) + PING_PROBE_MAX_PAYLOAD <= PBUF_POOL_BUFSIZE, "PING_PROBE_MAX_PAYLOAD does not fit PBUF_POOL_BUFSIZE");
+_Static_assert(PING_SWEEP_STEPS >= 2, "Sweep needs at least two payload sizes");
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint64_t tx_us;
+    uint16_t seq;
+    bool pending;
+} Ping_Slot_t;
+
+// Link and IP header room in front of the ICMP message, as pbuf_alloc(PBUF_IP) reserves
+#define PING_TX_HEADROOM        LWIP_MEM_ALIGN_SIZE(PBUF_IP)
+#define PING_TX_MSG_MAX         (sizeof(ICMP_EchoHeader_t) + PING_PROBE_MAX_PAYLOAD)
+
+/**
+ * @brief Statically allocated echo request
+ * @note Storage directly follows the pbuf, the layout of a PBUF_RAM allocation,
+ * so lwIP can prepend headers in place
+ */
+typedef struct {
+    struct pbuf_custom pc;
+    uint8_t mem[PING_TX_HEADROOM + PING_TX_MSG_MAX];
+} Ping_TxBuffer_t;
+
 /* Private variables ---------------------------------------------------------*/
+static const uint8_t qos_dscp[PING_AC_COUNT] = { QOS_DSCP_VO, QOS_DSCP_VI, QOS_DSCP_BE, QOS_DSCP_BK };
+static const char *const qos_names[PING_AC_COUNT] = { "vo", "vi", "be", "bk" };
 static struct raw_pcb *ping_pcb = NULL;
 static volatile uint64_t ping_rtt_us = 0;
 static volatile bool ping_done = false;
+// Single probe awaiting its reply, cleared on timeout so a late reply is not taken
+static volatile bool ping_pending = false;
 static volatile uint16_t echo_seq = 0;
+static volatile uint64_t ping_tx_us = 0;
+static uint32_t ping_tx_path_us = 0;
+static volatile uint32_t ping_rx_path_us = 0;
+static volatile uint64_t rx_input_us = 0;
+static struct netif *rx_netif = NULL;
+static netif_input_fn rx_netif_input = NULL;
+static Ping_Slot_t burst_slots[PING_BURST_MAX_INFLIGHT];
+static volatile uint16_t burst_inflight = 0;
+static volatile bool burst_active = false;
+static Stats_Summary_t *burst_summary = NULL;
+static volatile bool ping_tracing = false;
+// Echo requests in static storage, each sized for the largest probe and owned for good
+static Ping_TxBuffer_t tx_buffers[PING_TX_POOL_SIZE];
+static volatile bool tx_held[PING_TX_POOL_SIZE];
+static struct pbuf *tx_pool[PING_TX_POOL_SIZE];
+static void *tx_payload[PING_TX_POOL_SIZE];
+static uint8_t tx_next = 0;
+static uint64_t train_rx_us[PING_TRAIN_LENGTH];
+static volatile uint16_t train_first_seq = 0;
+static volatile uint16_t train_received = 0;
+static volatile bool train_active = false;
 
 /* Private function prototypes -----------------------------------------------*/
 static uint8_t ping_recv_callback(void *arg, struct raw_pcb *pcb, struct pbuf *p, const ip4_addr_t *addr);
-static void send_ping(const ip4_addr_t *dest, uint16_t seq);
+static bool send_ping(const ip4_addr_t *dest, uint16_t seq, uint16_t payload_len);
+static bool ping_wait_reply(uint32_t timeout_ms);
+static bool ping_reply_close(void);
+static bool ping_parse_addr(const char *ip_addr, ip4_addr_t *target_ip);
+static bool ping_begin(bool trace);
+static void ping_end(void);
+static struct pbuf *ping_tx_acquire(uint16_t len);
+static void ping_tx_free(struct pbuf *p);
+static void ping_distribution(uint32_t *samples, uint16_t count, Ping_Distribution_t *dist);
+static void burst_expire(uint64_t now_us, bool all);
+static err_t ping_netif_input(struct pbuf *p, struct netif *inp);
+
+
+/**
+ * @brief Create the raw ICMP PCB and the preallocated echo requests
+ * @return true on success, false otherwise
+ * @note Call after every Wi-Fi initialization. Probes then run without any
+ * heap allocation: the PCB stays bound and echo requests are reused. The station
+ * interface input is wrapped to timestamp frames handed over by the driver.
+ */
+bool ping_init(void) {
+    if (NULL != ping_pcb) {
+        return true;
+    }
+
+    cyw43_arch_lwip_begin();
+    ping_pcb = raw_new(IP_PROTO_ICMP);
+    if (NULL != ping_pcb) {
+        raw_bind(ping_pcb, IP_ADDR_ANY);
+        raw_recv(ping_pcb, ping_recv_callback, NULL);
+    }
+
+    if (NULL == rx_netif) {
+        rx_netif = &cyw43_state.netif[CYW43_ITF_STA];
+        rx_netif_input = rx_netif->input;
+        rx_netif->input = ping_netif_input;
+    }
+
+    bool pool_ok = true;
+    for (int i = 0; i < PING_TX_POOL_SIZE; i++) {
+        if (tx_held[i]) {
+            // Still referenced by lwIP from the previous session, left out of the pool
+            DBG("Echo request %d still in use\n", i);
+            continue;
+        }
+        tx_buffers[i].pc.custom_free_function = ping_tx_free;
+        tx_pool[i] = pbuf_alloced_custom(PBUF_IP, PING_TX_MSG_MAX, PBUF_RAM, &tx_buffers[i].pc,
+                                         tx_buffers[i].mem, sizeof(tx_buffers[i].mem));
+        if (NULL == tx_pool[i]) {
+            pool_ok = false;
+            break;
+        }
+        tx_held[i] = true;
+        tx_payload[i] = tx_pool[i]->payload;
+
+        // Counting pattern, so corrupted padding fails the checksum check on reply
+        uint8_t *data = (uint8_t *)tx_payload[i] + sizeof(ICMP_EchoHeader_t);
+        for (uint16_t j = 0; j < PING_PROBE_MAX_PAYLOAD; j++) {
+            data[j] = (uint8_t)j;
+        }
+    }
+    tx_next = 0;
+    cyw43_arch_lwip_end();
 
+    if (NULL == ping_pcb || !pool_ok) {
+        DBG("Failed to create raw protocol control block or echo request pool\n");
+        ping_deinit();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Remove the raw ICMP PCB and release the echo requests
+ * @note Call before Wi-Fi is de-initialized
+ */
+void ping_deinit(void) {
+    cyw43_arch_lwip_begin();
+    if (NULL != ping_pcb) {
+        raw_remove(ping_pcb);
+        ping_pcb = NULL;
+    }
+    if (NULL != rx_netif) {
+        rx_netif->input = rx_netif_input;
+        rx_netif = NULL;
+    }
+    for (int i = 0; i < PING_TX_POOL_SIZE; i++) {
+        if (NULL != tx_pool[i]) {
+            // A request still queued (e.g. waiting for ARP) is freed by its last holder
+            pbuf_free(tx_pool[i]);
+            tx_pool[i] = NULL;
+        }
+    }
+    ping_tracing = false;
+    cyw43_arch_lwip_end();
+}
 
 /** @brief Ping measurement function using ICMP
  * @param ping_handle Pointer to Ping_Handle_t
  * @param ip_addr Target IP address to ping
- * @return true on success, false otherwise
+ * @return true if any reply was received, false otherwise
+ * @note `sent` and `received` are set on every return, so a cycle with all
+ * probes lost still reports its losses
  */
 bool ping_measure(Ping_Handle_t *ping_handle, const char *ip_addr) {
     if (NULL == ping_handle || NULL == ip_addr) {
@@ -22,65 +173,465 @@ bool ping_measure(Ping_Handle_t *ping_handle, const char *ip_addr) {
         return false;
     }
 
-    // Validate IP
-    const char *scan = ip_addr;
-    int dot_c = 0;
-    while (*scan) {
-        if (*scan == '.') {
-            dot_c++;
-        } else if (*scan < '0' || *scan > '9') {
-            DBG("Invalid IP address format: %s\n", ip_addr);
-            return false;
+    // Counters are valid on every return, a failed setup is a cycle without probes
+    ping_handle->sent = 0;
+    ping_handle->received = 0;
+
+    // Convert str to ip4_addr_t
+    ip4_addr_t target_ip;
+    if (!ping_parse_addr(ip_addr, &target_ip)) {
+        return false;
+    }
+
+    if (!ping_begin(TRACE_ENABLE)) {
+        return false;
+    }
+    
+    for ( int i = 0; i < MAX_PING_COUNT; i++) {
+        ping_done = false;
+        // Probes that cannot be sent (link down, no route) count as lost
+        ping_handle->sent++;
+        bool sent = send_ping(&target_ip, ++echo_seq, 0);
+
+        if (sent && ping_wait_reply(PING_TIMEOUT_MS)) {
+            ping_handle->rtt_us[ping_handle->received] = ping_rtt_us;
+            ping_handle->stack_us[ping_handle->received++] = ping_tx_path_us + ping_rx_path_us;
+            DBG("Ping %d: %llu us (tx path %lu us, rx path %lu us)\n", i, ping_rtt_us,
+                ping_tx_path_us, ping_rx_path_us);
+        } else if (sent) {
+            DBG("Ping %d: timeout\n", i);
+            // Only probes that left the device are traced, with their own TX time
+            if (ping_tracing) {
+                cyw43_arch_lwip_begin();
+                trace_record_loss(echo_seq, ping_tx_us);
+                cyw43_arch_lwip_end();
+            }
+        } else {
+            DBG("Ping %d: not sent\n", i);
         }
-        scan++;
     }
-    if (dot_c != 3) {
-        DBG("Invalid target IP address format: %s\n", ip_addr);
+
+    ping_end();
+    return ping_handle->received > 0 ? true : false;
+}
+
+/**
+ * @brief Send a single echo request and wait for its reply
+ * @param[in] ip_addr Target IP address to ping
+ * @param[in] timeout_ms Reply timeout
+ * @param[out] rtt_us Round trip time of the reply
+ * @return true if the reply arrived in time, false otherwise
+ * @note The probe is not traced, so side measurements stay out of `wifi_trace`
+ */
+bool ping_once(const char *ip_addr, uint32_t timeout_ms, uint32_t *rtt_us) {
+    if (NULL == ip_addr || NULL == rtt_us) {
+        DBG("Invalid parameters\n");
         return false;
     }
 
-    // Convert str to ip4_addr_t
     ip4_addr_t target_ip;
-    target_ip.addr = ipaddr_addr(ip_addr);
+    if (!ping_parse_addr(ip_addr, &target_ip)) {
+        return false;
+    }
+
+    if (!ping_begin(false)) {
+        return false;
+    }
+
+    ping_done = false;
+    bool reply = send_ping(&target_ip, ++echo_seq, 0) && ping_wait_reply(timeout_ms);
+    if (reply) {
+        *rtt_us = (uint32_t)ping_rtt_us;
+    }
+
+    ping_end();
+    return reply;
+}
+
+/**
+ * @brief Measure the device-side cost of the send and receive paths
+ * @param[out] cal Pointer to calibration result
+ * @param[in] ip_addr Target IP address to ping
+ * @return true on success, false otherwise
+ * @note Both paths are measured on echoes to the target. The send path is the
+ * raw_sendto() duration, the receive path runs from the driver handing the
+ * frame to lwIP until the receive callback. SPI transfer and air time are in
+ * neither.
+ */
+bool ping_calibrate(Ping_Calibration_t *cal, const char *ip_addr) {
+    if (NULL == cal || NULL == ip_addr) {
+        DBG("Invalid parameters\n");
+        return false;
+    }
+
+    ip4_addr_t target_ip;
+    if (!ping_parse_addr(ip_addr, &target_ip)) {
+        return false;
+    }
+
+    if (!ping_begin(false)) {
+        return false;
+    }
+
+    uint32_t tx_samples[PING_CALIBRATION_COUNT];
+    uint32_t rx_samples[PING_CALIBRATION_COUNT];
+    uint16_t tx_count = 0;
+    uint16_t rx_count = 0;
+
+    for (int i = 0; i < PING_CALIBRATION_COUNT; i++) {
+        ping_done = false;
+        if (!send_ping(&target_ip, ++echo_seq, 0)) {
+            continue;
+        }
+        tx_samples[tx_count++] = ping_tx_path_us;
+
+        // Waiting for the reply also keeps the next send from queueing behind it
+        if (ping_wait_reply(PING_CALIBRATION_TIMEOUT_MS)) {
+            rx_samples[rx_count++] = ping_rx_path_us;
+        }
+    }
+    ping_distribution(tx_samples, tx_count, &cal->tx_path);
+    ping_distribution(rx_samples, rx_count, &cal->rx_path);
+
+    ping_end();
+
+    if (0 == cal->rx_path.samples) {
+        DBG("Calibration failed: no replies\n");
+        return false;
+    }
+
+    DBG("Calibration: tx path median %lu us, rx path median %lu us (p90 %lu us)\n",
+        cal->tx_path.median_us, cal->rx_path.median_us, cal->rx_path.p90_us);
+    return true;
+}
+
+/**
+ * @brief Fire probes at a high rate for a short window and aggregate the results
+ * @param[out] burst Pointer to burst result
+ * @param[in] ip_addr Target IP address to ping
+ * @return true if at least one reply was received, false otherwise
+ * @note Probes are pipelined: a new probe is sent every period regardless of
+ * outstanding replies. At most PING_BURST_MAX_INFLIGHT probes are outstanding,
+ * which bounds the pool pbufs the replies can take from the upload path. Ticks
+ * that hit the limit or fail to allocate are counted as skipped, not lost.
+ */
+bool ping_burst(Ping_Burst_t *burst, const char *ip_addr) {
+    if (NULL == burst || NULL == ip_addr) {
+        DBG("Invalid parameters\n");
+        return false;
+    }
+
+    memset(burst, 0, sizeof(*burst));
+    stats_reset(&burst->summary);
+
+    ip4_addr_t target_ip;
+    if (!ping_parse_addr(ip_addr, &target_ip)) {
+        return false;
+    }
+
+    burst->rate_hz = (PING_BURST_RATE_HZ > PING_BURST_MAX_RATE_HZ) ? PING_BURST_MAX_RATE_HZ : PING_BURST_RATE_HZ;
+    burst->duration_ms = PING_BURST_DURATION_MS;
+
+    if (!ping_begin(TRACE_ENABLE)) {
+        return false;
+    }
 
     cyw43_arch_lwip_begin();
-    ping_pcb = raw_new(IP_PROTO_ICMP);
+    memset(burst_slots, 0, sizeof(burst_slots));
+    burst_inflight = 0;
+    burst_summary = &burst->summary;
+    burst_active = true;
     cyw43_arch_lwip_end();
-    if (NULL == ping_pcb) {
-        DBG("Failed to create raw protocol control block\n");
-        return false;
+
+    uint64_t period_us = 1000000 / burst->rate_hz;
+    uint64_t now_us = time_us_64();
+    uint64_t next_us = now_us;
+    uint64_t end_us = now_us + burst->duration_ms * 1000ULL;
+
+    while ((now_us = time_us_64()) < end_us) {
+        if (now_us >= next_us) {
+            next_us += period_us;
+            // Do not catch up on missed ticks with back-to-back probes
+            if (next_us < now_us) {
+                next_us = now_us + period_us;
+            }
+
+            burst_expire(now_us, false);
+
+            uint16_t seq = echo_seq + 1;
+            cyw43_arch_lwip_begin();
+            bool can_send = burst_inflight < PING_BURST_MAX_INFLIGHT &&
+                !burst_slots[seq & (PING_BURST_MAX_INFLIGHT - 1)].pending;
+            cyw43_arch_lwip_end();
+
+            if (can_send && send_ping(&target_ip, ++echo_seq, 0)) {
+                burst->sent++;
+            } else {
+                burst->skipped++;
+            }
+        }
+        cyw43_arch_poll();
+        sleep_us(50);
+    }
+
+    // Give outstanding probes the timeout to come back
+    uint64_t drain_timeout = time_us_64() + PING_BURST_TIMEOUT_MS * 1000;
+    while (burst_inflight > 0 && time_us_64() < drain_timeout) {
+        cyw43_arch_poll();
+        sleep_us(100);
     }
+    burst_expire(time_us_64(), true);
 
     cyw43_arch_lwip_begin();
-    raw_bind(ping_pcb, IP_ADDR_ANY);
-    raw_recv(ping_pcb, ping_recv_callback, ping_handle);
+    burst_active = false;
+    burst_summary = NULL;
     cyw43_arch_lwip_end();
 
-    ping_handle->sent = MAX_PING_COUNT;
-    ping_handle->received = 0;
-    
-    for ( int i = 0; i < MAX_PING_COUNT; i++) {
-        ping_done = false;
-        send_ping(&target_ip, ++echo_seq);
-        
+    ping_end();
+
+    DBG("Burst: sent=%u, received=%lu, lost=%lu, skipped=%u\n", burst->sent,
+        burst->summary.count, burst->summary.lost, burst->skipped);
+    return burst->summary.count > 0;
+}
+
+/**
+ * @brief Sweep echo payload sizes and fit minimum RTT against size
+ * @param[out] sweep Pointer to sweep result
+ * @param[in] ip_addr Target IP address to ping
+ * @return true if at least two sizes got a reply, false otherwise
+ * @note Sizes are visited round-robin so slow drifts hit every size alike. The
+ * minimum RTT per size strips queueing, leaving the size-dependent cost; its
+ * least-squares slope is the round-trip cost per byte (request and reply both
+ * carry the payload), including device-side copy and checksum work.
+ */
+bool ping_sweep(Ping_Sweep_t *sweep, const char *ip_addr) {
+    if (NULL == sweep || NULL == ip_addr) {
+        DBG("Invalid parameters\n");
+        return false;
+    }
+
+    memset(sweep, 0, sizeof(*sweep));
+
+    ip4_addr_t target_ip;
+    if (!ping_parse_addr(ip_addr, &target_ip)) {
+        return false;
+    }
+
+    if (!ping_begin(false)) {
+        return false;
+    }
+
+    for (int step = 0; step < PING_SWEEP_STEPS; step++) {
+        sweep->payload[step] = (uint16_t)((PING_PROBE_MAX_PAYLOAD * step) / (PING_SWEEP_STEPS - 1));
+    }
+
+    for (int round = 0; round < PING_SWEEP_PROBES; round++) {
+        for (int step = 0; step < PING_SWEEP_STEPS; step++) {
+            ping_done = false;
+            if (!send_ping(&target_ip, ++echo_seq, sweep->payload[step]) || !ping_wait_reply(PING_TIMEOUT_MS)) {
+                continue;
+            }
+            if (0 == sweep->min_rtt_us[step] || ping_rtt_us < sweep->min_rtt_us[step]) {
+                sweep->min_rtt_us[step] = (uint32_t)ping_rtt_us;
+            }
+        }
+    }
+
+    ping_end();
+
+    // Least-squares fit of min RTT over payload size
+    float sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+    for (int step = 0; step < PING_SWEEP_STEPS; step++) {
+        if (0 == sweep->min_rtt_us[step]) {
+            continue;
+        }
+        float x = sweep->payload[step];
+        float y = sweep->min_rtt_us[step];
+        sum_x += x;
+        sum_y += y;
+        sum_xx += x * x;
+        sum_xy += x * y;
+        sweep->valid_steps++;
+    }
+
+    float n = sweep->valid_steps;
+    float denom = n * sum_xx - sum_x * sum_x;
+    if (sweep->valid_steps < 2 || denom <= 0.0f) {
+        DBG("Sweep failed: %u sizes answered\n", sweep->valid_steps);
+        return false;
+    }
+
+    float slope_us = (n * sum_xy - sum_x * sum_y) / denom;
+    sweep->slope_ns_per_byte = slope_us * 1000.0f;
+    sweep->intercept_us = (sum_y - slope_us * sum_x) / n;
+    DBG("Sweep: %.1f ns/byte, intercept %.0f us\n", sweep->slope_ns_per_byte, sweep->intercept_us);
+    return true;
+}
+
+/**
+ * @brief Estimate bottleneck capacity from back-to-back probe trains
+ * @param[out] train Pointer to train result
+ * @param[in] ip_addr Target IP address to ping
+ * @return true if at least one reply pair was received, false otherwise
+ * @note Each train sends PING_TRAIN_LENGTH maximum-size probes back to back; the
+ * bottleneck spreads them out and the replies keep that spacing. The median
+ * spacing over all trains rejects pairs compressed by receive-side batching or
+ * stretched by cross traffic. The estimate covers the slower of the two
+ * directions, and the device cannot send faster than its SPI link to the radio.
+ */
+bool ping_train(Ping_Train_t *train, const char *ip_addr) {
+    if (NULL == train || NULL == ip_addr) {
+        DBG("Invalid parameters\n");
+        return false;
+    }
+
+    memset(train, 0, sizeof(*train));
+    train->packet_bytes = IP_HLEN + sizeof(ICMP_EchoHeader_t) + PING_PROBE_MAX_PAYLOAD;
+
+    ip4_addr_t target_ip;
+    if (!ping_parse_addr(ip_addr, &target_ip)) {
+        return false;
+    }
+
+    if (!ping_begin(false)) {
+        return false;
+    }
+
+    static uint32_t gaps[PING_TRAIN_COUNT * (PING_TRAIN_LENGTH - 1)];
+
+    for (int t = 0; t < PING_TRAIN_COUNT; t++) {
+        cyw43_arch_lwip_begin();
+        memset(train_rx_us, 0, sizeof(train_rx_us));
+        train_first_seq = echo_seq + 1;
+        train_received = 0;
+        train_active = true;
+        cyw43_arch_lwip_end();
+
+        uint16_t sent = 0;
+        for (int i = 0; i < PING_TRAIN_LENGTH; i++) {
+            if (send_ping(&target_ip, ++echo_seq, PING_PROBE_MAX_PAYLOAD)) {
+                sent++;
+            }
+        }
+        train->sent += sent;
+
         uint64_t timeout = time_us_64() + PING_TIMEOUT_MS * 1000;
-        while (!ping_done && time_us_64() < timeout) {
+        while (train_received < sent && time_us_64() < timeout) {
             cyw43_arch_poll();
-            sleep_ms(1);
+            sleep_us(100);
         }
 
-        if( true == ping_done) {
-            ping_handle->rtt_us[ping_handle->received++] = ping_rtt_us;
-            DBG("Ping %d: %llu us\n", i, ping_rtt_us);
-        } else {
-            DBG("Ping %d: timeout\n", i);
+        cyw43_arch_lwip_begin();
+        train_active = false;
+        cyw43_arch_lwip_end();
+
+        train->received += train_received;
+        for (int i = 1; i < PING_TRAIN_LENGTH; i++) {
+            if (0 != train_rx_us[i - 1] && 0 != train_rx_us[i] && train_rx_us[i] > train_rx_us[i - 1]) {
+                gaps[train->gaps++] = (uint32_t)(train_rx_us[i] - train_rx_us[i - 1]);
+            }
+        }
+    }
+
+    ping_end();
+
+    if (0 == train->gaps) {
+        DBG("Train failed: no reply pairs\n");
+        return false;
+    }
+
+    Ping_Distribution_t dist;
+    ping_distribution(gaps, train->gaps, &dist);
+    train->dispersion_us = dist.median_us;
+    // bits per microsecond is Mbit/s
+    train->capacity_mbps = (train->packet_bytes * 8.0f) / (float)train->dispersion_us;
+    DBG("Train: %u/%u replies, dispersion %lu us, capacity %.1f Mbit/s\n",
+        train->received, train->sent, train->dispersion_us, train->capacity_mbps);
+    return true;
+}
+
+/**
+ * @brief Probe each WMM access category with DSCP-marked echoes
+ * @param[out] qos Pointer to per access category result
+ * @param[in] ip_addr Target IP address to ping
+ * @param[in] deadline_us time_us_64() by which probing must be finished, 0 for none
+ * @return true if any class got a reply, false otherwise
+ * @note Classes are interleaved probe by probe so they see the same load. Probes
+ * cut short by the deadline are not counted. The
+ * TOS byte is set on the raw PCB; echo replies carry the request's TOS, so the
+ * AP queues the downlink reply by class. The cyw43 driver hands frames to the
+ * radio without a priority, so the uplink request may stay in AC_BE.
+ */
+bool ping_qos(Ping_Qos_t *qos, const char *ip_addr, uint64_t deadline_us) {
+    if (NULL == qos || NULL == ip_addr) {
+        DBG("Invalid parameters\n");
+        return false;
+    }
+
+    for (int ac = 0; ac < PING_AC_COUNT; ac++) {
+        stats_reset(&qos->summary[ac]);
+        qos->dscp[ac] = qos_dscp[ac];
+    }
+
+    ip4_addr_t target_ip;
+    if (!ping_parse_addr(ip_addr, &target_ip)) {
+        return false;
+    }
+
+    if (!ping_begin(false)) {
+        return false;
+    }
+
+    bool any_reply = false;
+    bool expired = false;
+    for (int round = 0; round < QOS_PROBES_PER_CLASS && !expired; round++) {
+        for (int ac = 0; ac < PING_AC_COUNT; ac++) {
+            uint64_t timeout_ms = PING_TIMEOUT_MS;
+            if (0 != deadline_us) {
+                uint64_t now_us = time_us_64();
+                if (now_us >= deadline_us) {
+                    expired = true;
+                    break;
+                }
+                if ((deadline_us - now_us) / 1000 < timeout_ms) {
+                    timeout_ms = (deadline_us - now_us) / 1000;
+                }
+            }
+
+            cyw43_arch_lwip_begin();
+            ping_pcb->tos = (uint8_t)(qos_dscp[ac] << 2);
+            cyw43_arch_lwip_end();
+
+            ping_done = false;
+            if (send_ping(&target_ip, ++echo_seq, 0) && ping_wait_reply((uint32_t)timeout_ms)) {
+                stats_add(&qos->summary[ac], (uint32_t)ping_rtt_us);
+                any_reply = true;
+            } else if (0 == deadline_us || time_us_64() < deadline_us) {
+                stats_add_loss(&qos->summary[ac]);
+            }
         }
     }
 
+    // Other probe modes go out unmarked
     cyw43_arch_lwip_begin();
-    raw_remove(ping_pcb);
+    ping_pcb->tos = 0;
     cyw43_arch_lwip_end();
-    return ping_handle->received > 0 ? true : false;
+    ping_end();
+
+    for (int ac = 0; ac < PING_AC_COUNT; ac++) {
+        DBG("QoS %s (DSCP %u): received=%lu, lost=%lu, mean=%lu us\n", qos_names[ac], qos_dscp[ac],
+            qos->summary[ac].count, qos->summary[ac].lost, stats_mean_us(&qos->summary[ac]));
+    }
+    return any_reply;
+}
+
+/**
+ * @brief Access category tag name
+ * @param ac Access category
+ * @return Lower-case name ("vo", "vi", "be", "bk")
+ */
+const char *ping_ac_name(Ping_AccessCategory_t ac) {
+    return (ac < PING_AC_COUNT) ? qos_names[ac] : "unknown";
 }
 
 
@@ -91,32 +642,56 @@ bool ping_measure(Ping_Handle_t *ping_handle, const char *ip_addr) {
  * @param p Packet buffer containing the ICMP packet
  * @param addr Source IP address
  * @return 1 if the packet was processed, 0 otherwise
+ * @note Packets that are not replies to our probes are left to lwIP (e.g. echo
+ * requests are answered by the ICMP layer)
  */
 static uint8_t ping_recv_callback(void *arg, struct raw_pcb *pcb, struct pbuf *p, const ip4_addr_t *addr) {
-    struct ip_hdr *ip_hdr = (struct ip_hdr *)p->payload;
-    uint16_t hdr_len = IPH_HL(ip_hdr) * 4;
+    // Take the RX timestamp before any parsing
+    uint64_t now_us = time_us_64();
 
-    if (p->tot_len < hdr_len + sizeof(ICMP_EchoHeader_t)) {
-        // Dereference packet buffer because it is too small
-        pbuf_free(p);
+    // Replies are parsed in place, they always fit a single pool pbuf
+    if (p->len != p->tot_len) {
+        return 0;
+    }
+
+    uint16_t seq;
+    Echo_Reply_t reply = echo_parse_reply((const uint8_t *)p->payload, p->len, &seq);
+    if (ECHO_REPLY_NOT_OURS == reply) {
         return 0;
     }
+    if (ECHO_REPLY_CORRUPT == reply) {
+        pbuf_free(p);
+        return 1;
+    }
 
-    ICMP_EchoHeader_t *icmp_hdr = (ICMP_EchoHeader_t *)((uint8_t *)p->payload + hdr_len);
-    // Validate checksum
-    uint16_t checksum_recv = icmp_hdr->checksum;
-    // Set checksum to 0 for calculation
-    icmp_hdr->checksum = 0;
-    uint16_t checksum_calc = inet_chksum(icmp_hdr, sizeof(ICMP_EchoHeader_t));
-    if (icmp_hdr->type == ICMP_ER && lwip_ntohs(icmp_hdr->id) == 0xBADA && checksum_recv == checksum_calc) {
-        uint64_t now_us = time_us_64();
-        uint64_t timestamp = ntohl(icmp_hdr->timestamp);
-        // Convert to microseconds
-        timestamp *= 1000; 
-        ping_rtt_us = now_us - timestamp;
+    if (burst_active) {
+        Ping_Slot_t *slot = &burst_slots[seq & (PING_BURST_MAX_INFLIGHT - 1)];
+        // Late replies of expired probes find their slot free and are ignored
+        if (slot->pending && slot->seq == seq) {
+            uint32_t rtt_us = (uint32_t)(now_us - slot->tx_us);
+            slot->pending = false;
+            burst_inflight--;
+            stats_add(burst_summary, rtt_us);
+            if (ping_tracing) {
+                trace_record(seq, slot->tx_us, rtt_us);
+            }
+        }
+    } else if (train_active) {
+        uint16_t idx = (uint16_t)(seq - train_first_seq);
+        if (idx < PING_TRAIN_LENGTH && 0 == train_rx_us[idx]) {
+            train_rx_us[idx] = now_us;
+            train_received++;
+        }
+    } else if (ping_pending && seq == echo_seq) {
+        ping_pending = false;
+        ping_rtt_us = now_us - ping_tx_us;
+        // Same frame: the driver handoff runs the input chain down to this callback
+        uint64_t input_us = rx_input_us;
+        ping_rx_path_us = (0 != input_us && input_us <= now_us) ? (uint32_t)(now_us - input_us) : 0;
         ping_done = true;
-    } else {
-        ping_done = false;
+        if (ping_tracing) {
+            trace_record(seq, ping_tx_us, (uint32_t)ping_rtt_us);
+        }
     }
 
     pbuf_free(p);
@@ -127,33 +702,52 @@ static uint8_t ping_recv_callback(void *arg, struct raw_pcb *pcb, struct pbuf *p
  * @brief Send a single ICMP echo request
  * @param dest Destination IP addr
  * @param seq Sequence number
+ * @param payload_len Bytes of padding after the echo header, up to PING_PROBE_MAX_PAYLOAD
+ * @return true on success, false otherwise
+ * @note The TX timestamp is taken right before raw_sendto(), so packet
+ * preparation is not part of the RTT but the send path is. The send path cost,
+ * until the frame has been handed to the driver, is kept in `ping_tx_path_us`.
+ * The request comes from the preallocated pool, nothing is allocated here.
  */
-static void send_ping(const ip4_addr_t *dest, uint16_t seq) {
-    ICMP_EchoHeader_t icmp_hdr = {
-        .type = ICMP_ECHO,
-        .code = 0,
-        .checksum = 0,
-        .id = lwip_htons(0xBADA),
-        .sequence = lwip_htons(seq),
-        .timestamp = htonl(time_us_64() / 1000) // ms
-    };
-
-    // Calculate checksum
-    icmp_hdr.checksum = inet_chksum(&icmp_hdr, sizeof(ICMP_EchoHeader_t));
+static bool send_ping(const ip4_addr_t *dest, uint16_t seq, uint16_t payload_len) {
+    if (payload_len > PING_PROBE_MAX_PAYLOAD) {
+        payload_len = PING_PROBE_MAX_PAYLOAD;
+    }
+    uint16_t len = sizeof(ICMP_EchoHeader_t) + payload_len;
 
-    struct pbuf *p = pbuf_alloc(PBUF_IP, sizeof(ICMP_EchoHeader_t), PBUF_RAM);
+    cyw43_arch_lwip_begin();
+    struct pbuf *p = ping_tx_acquire(len);
+    cyw43_arch_lwip_end();
     if (NULL == p) {
-        DBG("Failed to allocate pbuf\n");
-        return;
+        DBG("No free echo request buffer\n");
+        return false;
     }
 
-    // Copy the ICMP header into the pbuf
-    memcpy(p->payload, &icmp_hdr, sizeof(ICMP_EchoHeader_t));
-    // Send the ICMP echo request
+    // Fill the header in place, the padding pattern was written once by ping_init()
+    echo_build_request((uint8_t *)p->payload, len, seq, (uint32_t)(time_us_64() / 1000));
+
+    // Send the ICMP echo request, the receive callback cannot run while the lock is held
     cyw43_arch_lwip_begin();
-    raw_sendto(ping_pcb, p, (const ip_addr_t*)dest);
+    ping_tx_us = time_us_64();
+    err_t err = raw_sendto(ping_pcb, p, (const ip_addr_t*)dest);
+    uint64_t sent_us = time_us_64();
+    // Burst and train probes are matched by their own state
+    ping_pending = (ERR_OK == err) && !burst_active && !train_active;
+    if (burst_active && ERR_OK == err) {
+        Ping_Slot_t *slot = &burst_slots[seq & (PING_BURST_MAX_INFLIGHT - 1)];
+        slot->tx_us = ping_tx_us;
+        slot->seq = seq;
+        slot->pending = true;
+        burst_inflight++;
+    }
     cyw43_arch_lwip_end();
-    pbuf_free(p);
+
+    ping_tx_path_us = (uint32_t)(sent_us - ping_tx_us);
+    if (ERR_OK != err) {
+        DBG("Failed to send echo request: %d\n", err);
+        return false;
+    }
+    return true;
 }
 
 /**
@@ -201,8 +795,239 @@ bool ping_calculate_stats(Ping_Handle_t *ping_handle, uint64_t *avg_rtt_us,
     }
 
     *avg_rtt_us = total_rtt_us / ping_handle->received;
-    *loss_p = (ping_handle->sent - ping_handle->received) / ping_handle->sent * 100;
+    *loss_p = (ping_handle->sent - ping_handle->received) * 100 / ping_handle->sent;
     *jitt_us = *max_rtt_us - *min_rtt_us;
 
     return true;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Calculate RTT statistics corrected for the device-side stack cost
+ * @param[in] ping_handle Pointer to a ping handle structure with measurement results
+ * @param[out] avg_rtt_us Average corrected round trip time in microseconds
+ * @param[out] min_rtt_us Minimum corrected round trip time in microseconds
+ * @param[out] max_rtt_us Maximum corrected round trip time in microseconds
+ * @return true on success, false if no reply was received
+ * @note Each reply's own send and receive path cost is subtracted from its RTT
+ */
+bool ping_corrected_stats(const Ping_Handle_t *ping_handle, uint64_t *avg_rtt_us,
+                          uint64_t *min_rtt_us, uint64_t *max_rtt_us) {
+    if (NULL == ping_handle || NULL == avg_rtt_us || NULL == min_rtt_us || NULL == max_rtt_us) {
+        DBG("Invalid parameters\n");
+        return false;
+    }
+
+    if (0 == ping_handle->received) {
+        return false;
+    }
+
+    uint64_t total_rtt_us = 0;
+    *min_rtt_us = UINT64_MAX;
+    *max_rtt_us = 0;
+
+    for (int i = 0; i < ping_handle->received; i++) {
+        uint64_t rtt_us = ping_handle->rtt_us[i];
+        rtt_us = rtt_us > ping_handle->stack_us[i] ? rtt_us - ping_handle->stack_us[i] : 0;
+        total_rtt_us += rtt_us;
+
+        if (rtt_us < *min_rtt_us) {
+            *min_rtt_us = rtt_us;
+        }
+
+        if (rtt_us > *max_rtt_us) {
+            *max_rtt_us = rtt_us;
+        }
+    }
+
+    *avg_rtt_us = total_rtt_us / ping_handle->received;
+    return true;
+}
+
+/**
+ * @brief Wait for the reply to the last single probe
+ * @param timeout_ms Reply timeout
+ * @return true if the reply arrived, false on timeout
+ */
+static bool ping_wait_reply(uint32_t timeout_ms) {
+    uint64_t timeout = time_us_64() + timeout_ms * 1000ULL;
+    while (!ping_done && time_us_64() < timeout) {
+        cyw43_arch_poll();
+        sleep_us(100);
+    }
+    return ping_reply_close();
+}
+
+/**
+ * @brief Stop waiting for the last single probe
+ * @return true if its reply arrived, false otherwise
+ * @note From here on a late reply no longer matches, so a probe is never
+ * recorded as both lost and answered
+ */
+static bool ping_reply_close(void) {
+    cyw43_arch_lwip_begin();
+    ping_pending = false;
+    bool done = ping_done;
+    cyw43_arch_lwip_end();
+    return done;
+}
+
+/**
+ * @brief Validate and convert a dotted IPv4 address string
+ * @param[in] ip_addr IP address string
+ * @param[out] target_ip Converted address
+ * @return true on success, false otherwise
+ */
+static bool ping_parse_addr(const char *ip_addr, ip4_addr_t *target_ip) {
+    // Validate IP
+    const char *scan = ip_addr;
+    int dot_c = 0;
+    while (*scan) {
+        if (*scan == '.') {
+            dot_c++;
+        } else if (*scan < '0' || *scan > '9') {
+            DBG("Invalid IP address format: %s\n", ip_addr);
+            return false;
+        }
+        scan++;
+    }
+    if (dot_c != 3) {
+        DBG("Invalid target IP address format: %s\n", ip_addr);
+        return false;
+    }
+
+    target_ip->addr = ipaddr_addr(ip_addr);
+    return true;
+}
+
+/**
+ * @brief Check that the persistent PCB is ready for a probe run
+ * @param trace true to record the run's probes in the packet trace
+ * @return true if ping_init() succeeded, false otherwise
+ * @note The trace flag is read by the receive callback, it is set under the lock
+ */
+static bool ping_begin(bool trace) {
+    if (NULL == ping_pcb) {
+        DBG("Ping not initialized\n");
+        return false;
+    }
+    cyw43_arch_lwip_begin();
+    ping_tracing = trace;
+    cyw43_arch_lwip_end();
+    return true;
+}
+
+/**
+ * @brief Finish a probe run, the PCB stays bound for the next one
+ */
+static void ping_end(void) {
+    cyw43_arch_lwip_begin();
+    ping_tracing = false;
+    cyw43_arch_lwip_end();
+}
+
+/**
+ * @brief Take a free preallocated echo request and size it for a probe
+ * @param len ICMP message length, at most the header plus PING_PROBE_MAX_PAYLOAD
+ * @return Echo request with payload pointing at the ICMP header, NULL if all are in use
+ * @note Must be called with the lwIP lock held. A request is free when only the
+ * pool holds it; one still referenced (e.g. queued while ARP resolves) is skipped.
+ * lwIP leaves the link and IP headers in front of the payload after sending,
+ * they are stripped again here.
+ */
+static struct pbuf *ping_tx_acquire(uint16_t len) {
+    for (int i = 0; i < PING_TX_POOL_SIZE; i++) {
+        uint8_t idx = (tx_next + i) % PING_TX_POOL_SIZE;
+        struct pbuf *p = tx_pool[idx];
+        if (NULL == p || 1 != p->ref) {
+            continue;
+        }
+
+        size_t headers = (uint8_t *)tx_payload[idx] - (uint8_t *)p->payload;
+        if (headers > 0 && 0 != pbuf_remove_header(p, headers)) {
+            continue;
+        }
+        // Single buffer sized for the largest probe, only the length changes
+        LWIP_ASSERT("echo request must be a single pbuf", NULL == p->next);
+        LWIP_ASSERT("echo request too long", len <= PING_TX_MSG_MAX);
+        p->len = len;
+        p->tot_len = len;
+
+        tx_next = (idx + 1) % PING_TX_POOL_SIZE;
+        return p;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Custom pbuf free function of the echo requests
+ * @param p Echo request whose last reference was released
+ * @note Runs in lwIP context. Storage is static, the slot only becomes reusable
+ */
+static void ping_tx_free(struct pbuf *p) {
+    Ping_TxBuffer_t *buffer = (Ping_TxBuffer_t *)p;
+    tx_held[buffer - tx_buffers] = false;
+}
+
+/**
+ * @brief Summarize path cost samples
+ * @param[in,out] samples Sample array, sorted in place
+ * @param[in] count Number of samples
+ * @param[out] dist Distribution summary
+ */
+static void ping_distribution(uint32_t *samples, uint16_t count, Ping_Distribution_t *dist) {
+    memset(dist, 0, sizeof(*dist));
+    dist->samples = count;
+    if (0 == count) {
+        return;
+    }
+
+    // Insertion sort, sample count is small
+    for (uint16_t i = 1; i < count; i++) {
+        uint32_t value = samples[i];
+        int j = i - 1;
+        while (j >= 0 && samples[j] > value) {
+            samples[j + 1] = samples[j];
+            j--;
+        }
+        samples[j + 1] = value;
+    }
+
+    dist->min_us = samples[0];
+    dist->median_us = samples[count / 2];
+    dist->p90_us = samples[(count * 9) / 10];
+    dist->max_us = samples[count - 1];
+}
+
+/**
+ * @brief Count outstanding burst probes as lost once they time out
+ * @param now_us Current time
+ * @param all Expire every outstanding probe regardless of its age
+ */
+static void burst_expire(uint64_t now_us, bool all) {
+    cyw43_arch_lwip_begin();
+    for (int i = 0; i < PING_BURST_MAX_INFLIGHT; i++) {
+        Ping_Slot_t *slot = &burst_slots[i];
+        if (slot->pending && (all || now_us - slot->tx_us >= PING_BURST_TIMEOUT_MS * 1000ULL)) {
+            slot->pending = false;
+            burst_inflight--;
+            stats_add_loss(burst_summary);
+            if (ping_tracing) {
+                trace_record_loss(slot->seq, slot->tx_us);
+            }
+        }
+    }
+    cyw43_arch_lwip_end();
+}
+
+/**
+ * @brief Station interface input wrapper, stamps frames handed over by the driver
+ * @param p Received frame
+ * @param inp Receiving interface
+ * @return Result of the original input function
+ * @note Runs with the lwIP lock held, the frame is processed synchronously, so a
+ * reply reaching ping_recv_callback() still finds its own timestamp
+ */
+static err_t ping_netif_input(struct pbuf *p, struct netif *inp) {
+    rx_input_us = time_us_64();
+    return rx_netif_input(p, inp);
+}
@@ -44,9 +44,5 @@ float temperature_read_celsius() {
         sleep_us(50);
     }
     
-    // Convert to volts
-    const float adc_voltage = (sum / (float)TEMP_SAMPLE_COUNT) * 3.3f / 4096.0f;
-    
-    // Convert volts to temperature using the formula from RP2040 datasheet
-    return 27.0f - (adc_voltage - 0.706f) / 0.001721f;
+    return temperature_from_adc(sum, TEMP_SAMPLE_COUNT);
 }
\ No newline at end of file
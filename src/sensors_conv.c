@@ -0,0 +1,15 @@
+#include "sensors_conv.h"
+
+/**
+ * @brief Average summed temperature sensor samples and convert them to Celsius
+ * @param sum Sum of 12-bit ADC samples
+ * @param count Number of samples in the sum
+ * @return Temperature in degrees Celsius
+ */
+float temperature_from_adc(uint32_t sum, uint32_t count) {
+    // Convert to volts
+    const float adc_voltage = (sum / (float)count) * 3.3f / 4096.0f;
+
+    // Convert volts to temperature using the formula from RP2040 datasheet
+    return 27.0f - (adc_voltage - 0.706f) / 0.001721f;
+}
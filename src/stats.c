@@ -0,0 +1,286 @@
+#include "stats.h"
+#include <math.h>
+
+/* Private variables ---------------------------------------------------------*/
+// Upper bin edges in microseconds, roughly half-octave steps
+static const uint32_t bin_edges_us[STATS_HIST_BINS - 1] = {
+    250, 500, 750, 1000, 1500, 2000, 3000, 4000,
+    6000, 8000, 12000, 16000, 32000, 64000, 128000
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t stats_bin(uint32_t rtt_us);
+static void stats_window_advance(Stats_Window_t *window, uint64_t now_us);
+static void stats_window_evict(Stats_Window_t *window, const Stats_Summary_t *bucket);
+
+
+/**
+ * @brief Reset a summary to empty
+ * @param summary Pointer to summary
+ */
+void stats_reset(Stats_Summary_t *summary) {
+    memset(summary, 0, sizeof(*summary));
+    summary->min_us = UINT32_MAX;
+}
+
+/**
+ * @brief Add an RTT sample to a summary
+ * @param summary Pointer to summary
+ * @param rtt_us RTT in microseconds
+ */
+void stats_add(Stats_Summary_t *summary, uint32_t rtt_us) {
+    summary->count++;
+    summary->sum_us += rtt_us;
+    summary->sum_sq_us += (uint64_t)rtt_us * rtt_us;
+    if (rtt_us < summary->min_us) {
+        summary->min_us = rtt_us;
+    }
+    if (rtt_us > summary->max_us) {
+        summary->max_us = rtt_us;
+    }
+    summary->bins[stats_bin(rtt_us)]++;
+}
+
+/**
+ * @brief Add a lost probe to a summary
+ * @param summary Pointer to summary
+ */
+void stats_add_loss(Stats_Summary_t *summary) {
+    summary->lost++;
+}
+
+/**
+ * @brief Mean RTT of a summary
+ * @param summary Pointer to summary
+ * @return Mean RTT in microseconds, 0 if there are no samples
+ */
+uint32_t stats_mean_us(const Stats_Summary_t *summary) {
+    if (0 == summary->count) {
+        return 0;
+    }
+    return (uint32_t)(summary->sum_us / summary->count);
+}
+
+/**
+ * @brief RTT standard deviation of a summary
+ * @param summary Pointer to summary
+ * @return Population standard deviation in microseconds
+ */
+uint32_t stats_stddev_us(const Stats_Summary_t *summary) {
+    if (summary->count < 2) {
+        return 0;
+    }
+    double mean = (double)summary->sum_us / summary->count;
+    double var = (double)summary->sum_sq_us / summary->count - mean * mean;
+    return (var > 0.0) ? (uint32_t)sqrt(var) : 0;
+}
+
+/**
+ * @brief Estimate an RTT percentile from the histogram
+ * @param summary Pointer to summary
+ * @param pct Percentile (0-100)
+ * @return RTT in microseconds, linearly interpolated inside the bin
+ * @note Result is clamped to the observed min/max
+ */
+uint32_t stats_percentile_us(const Stats_Summary_t *summary, uint8_t pct) {
+    if (0 == summary->count) {
+        return 0;
+    }
+    if (pct > 100) {
+        pct = 100;
+    }
+
+    // Rank of the requested sample (1-based)
+    uint32_t rank = (uint32_t)(((uint64_t)summary->count * pct + 99) / 100);
+    if (0 == rank) {
+        rank = 1;
+    }
+
+    uint32_t seen = 0;
+    for (int i = 0; i < STATS_HIST_BINS; i++) {
+        if (0 == summary->bins[i]) {
+            continue;
+        }
+        if (seen + summary->bins[i] >= rank) {
+            uint32_t lo = (i > 0) ? bin_edges_us[i - 1] : 0;
+            uint32_t hi = (i < STATS_HIST_BINS - 1) ? bin_edges_us[i] : summary->max_us;
+            if (lo < summary->min_us) {
+                lo = summary->min_us;
+            }
+            if (hi > summary->max_us) {
+                hi = summary->max_us;
+            }
+            if (hi <= lo) {
+                return lo;
+            }
+            uint32_t in_bin = rank - seen;
+            return lo + (uint32_t)((uint64_t)(hi - lo) * in_bin / summary->bins[i]);
+        }
+        seen += summary->bins[i];
+    }
+    return summary->max_us;
+}
+
+/**
+ * @brief Loss percentage of a summary
+ * @param summary Pointer to summary
+ * @return Lost probes over all probes in percent
+ */
+float stats_loss_pct(const Stats_Summary_t *summary) {
+    uint32_t total = summary->count + summary->lost;
+    if (0 == total) {
+        return 0.0f;
+    }
+    return 100.0f * summary->lost / total;
+}
+
+/**
+ * @brief Upper edge of a histogram bin
+ * @param bin Bin index
+ * @return Edge in microseconds, UINT32_MAX for the open-ended last bin
+ */
+uint32_t stats_bin_edge_us(uint8_t bin) {
+    if (bin >= STATS_HIST_BINS - 1) {
+        return UINT32_MAX;
+    }
+    return bin_edges_us[bin];
+}
+
+/**
+ * @brief Set up a sliding window
+ * @param window Pointer to window
+ * @param bucket_ms Bucket width in milliseconds
+ * @param num_buckets Number of buckets, window length is num_buckets * bucket_ms
+ * @param now_us Current time
+ * @return false if the bucket count is out of range
+ */
+bool stats_window_init(Stats_Window_t *window, uint32_t bucket_ms, uint8_t num_buckets, uint64_t now_us) {
+    if (0 == num_buckets || num_buckets > STATS_WINDOW_MAX_BUCKETS || 0 == bucket_ms) {
+        return false;
+    }
+
+    for (int i = 0; i < STATS_WINDOW_MAX_BUCKETS; i++) {
+        stats_reset(&window->buckets[i]);
+    }
+    stats_reset(&window->total);
+    window->bucket_us = bucket_ms * 1000ULL;
+    window->head_start_us = now_us;
+    window->num_buckets = num_buckets;
+    window->head = 0;
+    return true;
+}
+
+/**
+ * @brief Add an RTT sample to a sliding window
+ * @param window Pointer to window
+ * @param now_us Current time
+ * @param rtt_us RTT in microseconds
+ * @note O(1), except for a min/max rescan over the buckets when an expiring
+ * bucket held the window extreme
+ */
+void stats_window_add(Stats_Window_t *window, uint64_t now_us, uint32_t rtt_us) {
+    stats_window_advance(window, now_us);
+    stats_add(&window->buckets[window->head], rtt_us);
+    stats_add(&window->total, rtt_us);
+}
+
+/**
+ * @brief Add a lost probe to a sliding window
+ * @param window Pointer to window
+ * @param now_us Current time
+ */
+void stats_window_add_loss(Stats_Window_t *window, uint64_t now_us) {
+    stats_window_advance(window, now_us);
+    stats_add_loss(&window->buckets[window->head]);
+    stats_add_loss(&window->total);
+}
+
+/**
+ * @brief Summary of the samples currently inside a sliding window
+ * @param window Pointer to window
+ * @param now_us Current time
+ * @return Pointer to the running total, valid until the next window call
+ */
+const Stats_Summary_t *stats_window_get(Stats_Window_t *window, uint64_t now_us) {
+    stats_window_advance(window, now_us);
+    return &window->total;
+}
+
+/**
+ * @brief Rotate buckets up to the current time, evicting expired ones
+ * @param window Pointer to window
+ * @param now_us Current time
+ */
+static void stats_window_advance(Stats_Window_t *window, uint64_t now_us) {
+    if (now_us < window->head_start_us + window->bucket_us) {
+        return;
+    }
+
+    uint64_t steps = (now_us - window->head_start_us) / window->bucket_us;
+    if (steps >= window->num_buckets) {
+        // Idle for longer than the window, everything expired
+        for (int i = 0; i < window->num_buckets; i++) {
+            stats_reset(&window->buckets[i]);
+        }
+        stats_reset(&window->total);
+    } else {
+        for (uint64_t i = 0; i < steps; i++) {
+            window->head = (window->head + 1) % window->num_buckets;
+            stats_window_evict(window, &window->buckets[window->head]);
+            stats_reset(&window->buckets[window->head]);
+        }
+    }
+    window->head_start_us += steps * window->bucket_us;
+}
+
+/**
+ * @brief Subtract an expiring bucket from the window total
+ * @param window Pointer to window
+ * @param bucket Bucket leaving the window
+ */
+static void stats_window_evict(Stats_Window_t *window, const Stats_Summary_t *bucket) {
+    Stats_Summary_t *total = &window->total;
+
+    if (0 == bucket->count && 0 == bucket->lost) {
+        return;
+    }
+
+    total->count -= bucket->count;
+    total->lost -= bucket->lost;
+    total->sum_us -= bucket->sum_us;
+    total->sum_sq_us -= bucket->sum_sq_us;
+    for (int i = 0; i < STATS_HIST_BINS; i++) {
+        total->bins[i] -= bucket->bins[i];
+    }
+
+    // Min/max are not subtractable, rescan the remaining buckets if needed
+    if (bucket->count > 0 && (bucket->min_us <= total->min_us || bucket->max_us >= total->max_us)) {
+        total->min_us = UINT32_MAX;
+        total->max_us = 0;
+        for (int i = 0; i < window->num_buckets; i++) {
+            const Stats_Summary_t *b = &window->buckets[i];
+            if (b == bucket || 0 == b->count) {
+                continue;
+            }
+            if (b->min_us < total->min_us) {
+                total->min_us = b->min_us;
+            }
+            if (b->max_us > total->max_us) {
+                total->max_us = b->max_us;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Find the histogram bin for an RTT sample
+ * @param rtt_us RTT in microseconds
+ * @return Bin index
+ */
+static uint8_t stats_bin(uint32_t rtt_us) {
+    uint8_t bin = 0;
+    while (bin < STATS_HIST_BINS - 1 && rtt_us > bin_edges_us[bin]) {
+        bin++;
+    }
+    return bin;
+}
@@ -0,0 +1,149 @@
+#include "timesync.h"
+
+/* Private variables ---------------------------------------------------------*/
+// Wall clock model: unix_us = local_us + offset_us + drift over (local_us - sync_local_us)
+static int64_t offset_us = 0;
+static uint64_t sync_local_us = 0;
+static int32_t drift_ppb = 0;
+static uint32_t sync_count = 0;
+static int64_t last_step_us = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint64_t local_to_unix_us(uint64_t local_us);
+
+
+/**
+ * @brief Start periodic SNTP synchronisation against the local NTP server
+ * @return true on success, false otherwise
+ * @note Must be called again after every Wi-Fi re-initialization
+ */
+bool timesync_start(void) {
+    ip_addr_t ntp_ip;
+    ntp_ip.addr = ipaddr_addr(NTP_SERVER_IP);
+    if (IPADDR_NONE == ntp_ip.addr) {
+        DBG("Invalid NTP server IP address: %s\n", NTP_SERVER_IP);
+        return false;
+    }
+
+    cyw43_arch_lwip_begin();
+    if (sntp_enabled()) {
+        sntp_stop();
+    }
+    sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    sntp_setserver(0, &ntp_ip);
+    sntp_init();
+    cyw43_arch_lwip_end();
+
+    DBG("SNTP started against %s\n", NTP_SERVER_IP);
+    return true;
+}
+
+/**
+ * @brief Stop SNTP synchronisation
+ * @note The clock model is kept, so capture times can still be converted while
+ * Wi-Fi is down
+ */
+void timesync_stop(void) {
+    cyw43_arch_lwip_begin();
+    if (sntp_enabled()) {
+        sntp_stop();
+    }
+    cyw43_arch_lwip_end();
+}
+
+/**
+ * @brief Convert a time_us_64() capture time to Unix time
+ * @param local_us Capture time from time_us_64()
+ * @return Unix time in microseconds, 0 if the clock was never synchronised
+ */
+uint64_t timesync_to_unix_us(uint64_t local_us) {
+    uint64_t unix_us = 0;
+    cyw43_arch_lwip_begin();
+    if (sync_count > 0) {
+        unix_us = local_to_unix_us(local_us);
+    }
+    cyw43_arch_lwip_end();
+    return unix_us;
+}
+
+/**
+ * @brief Get a snapshot of the synchronisation status
+ * @param[out] status Pointer to status structure
+ */
+void timesync_get_status(Timesync_Status_t *status) {
+    if (NULL == status) {
+        return;
+    }
+
+    cyw43_arch_lwip_begin();
+    status->synced = sync_count > 0;
+    status->syncs = sync_count;
+    status->step_us = last_step_us;
+    status->drift_ppb = drift_ppb;
+    status->last_sync_us = sync_local_us;
+    cyw43_arch_lwip_end();
+}
+
+/**
+ * @brief SNTP_SET_SYSTEM_TIME_US hook, called from lwIP context
+ * @param sec Unix seconds (round trip compensated)
+ * @param us Microseconds part
+ */
+void timesync_set_system_time_us(uint32_t sec, uint32_t us) {
+    uint64_t now_us = time_us_64();
+    uint64_t server_us = (uint64_t)sec * 1000000ULL + us;
+    int64_t new_offset_us = (int64_t)(server_us - now_us);
+
+    if (sync_count > 0) {
+        // Difference between the server and the current model is the step
+        last_step_us = (int64_t)(server_us - local_to_unix_us(now_us));
+
+        // Offset change over elapsed local time is the clock frequency error. A large
+        // step is a server or RTC jump, not drift, and is only applied to the offset
+        uint64_t elapsed_us = now_us - sync_local_us;
+        bool step_ok = llabs(last_step_us) <= TIMESYNC_MAX_STEP_US;
+        if (!step_ok) {
+            DBG("Time step of %lld us, drift estimate kept\n", last_step_us);
+        }
+        if (step_ok && elapsed_us > 0) {
+            // Double keeps the ratio from overflowing for any offset change
+            double measured_ppb = (double)(new_offset_us - offset_us) * 1e9 / (double)elapsed_us;
+            // Smooth the estimate (EWMA, alpha = 1/4), first estimate is taken as is
+            double estimate_ppb = (sync_count > 1) ? drift_ppb + (measured_ppb - drift_ppb) / 4 : measured_ppb;
+            // Beyond crystal tolerance the estimate is noise
+            if (estimate_ppb > TIMESYNC_MAX_DRIFT_PPB) {
+                estimate_ppb = TIMESYNC_MAX_DRIFT_PPB;
+            } else if (estimate_ppb < -TIMESYNC_MAX_DRIFT_PPB) {
+                estimate_ppb = -TIMESYNC_MAX_DRIFT_PPB;
+            }
+            drift_ppb = (int32_t)estimate_ppb;
+        }
+    }
+
+    offset_us = new_offset_us;
+    sync_local_us = now_us;
+    sync_count++;
+}
+
+/**
+ * @brief SNTP_GET_SYSTEM_TIME hook, used by lwIP for round trip compensation
+ * @param[out] sec Unix seconds
+ * @param[out] us Microseconds part
+ */
+void timesync_get_system_time_us(uint32_t *sec, uint32_t *us) {
+    uint64_t unix_us = local_to_unix_us(time_us_64());
+    *sec = (uint32_t)(unix_us / 1000000ULL);
+    *us = (uint32_t)(unix_us % 1000000ULL);
+}
+
+/**
+ * @brief Apply the clock model to a local timestamp
+ * @param local_us time_us_64() value
+ * @return Unix time in microseconds
+ * @note Caller must hold the lwIP lock or run in lwIP context
+ */
+static uint64_t local_to_unix_us(uint64_t local_us) {
+    int64_t since_sync_us = (int64_t)(local_us - sync_local_us);
+    int64_t drift_us = since_sync_us * drift_ppb / 1000000000LL;
+    return (uint64_t)((int64_t)local_us + offset_us + drift_us);
+}
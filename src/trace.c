@@ -0,0 +1,219 @@
+#include "trace.h"
+
+/* Private variables ---------------------------------------------------------*/
+static Trace_Record_t trace_ring[TRACE_RING_SIZE];
+static uint16_t trace_head = 0;
+static uint16_t trace_count = 0;
+static uint32_t trace_dropped = 0;
+
+static const char base64_chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Private function prototypes -----------------------------------------------*/
+static void trace_push(uint16_t seq, uint64_t tx_us, uint32_t rtt_us, bool lost);
+static size_t put_varint(uint8_t *out, uint64_t value);
+static uint64_t zigzag(int64_t value);
+
+
+/**
+ * @brief Record a probe reply
+ * @param seq ICMP sequence number
+ * @param tx_us Send time
+ * @param rtt_us Round trip time
+ */
+void trace_record(uint16_t seq, uint64_t tx_us, uint32_t rtt_us) {
+    trace_push(seq, tx_us, rtt_us, false);
+}
+
+/**
+ * @brief Record a lost probe
+ * @param seq ICMP sequence number
+ * @param tx_us Send time
+ */
+void trace_record_loss(uint16_t seq, uint64_t tx_us) {
+    trace_push(seq, tx_us, 0, true);
+}
+
+/**
+ * @brief Number of records waiting for upload
+ * @return Record count
+ */
+uint16_t trace_pending(void) {
+    return trace_count;
+}
+
+/**
+ * @brief Get the oldest pending record
+ * @param[out] record Destination
+ * @return false if the ring is empty
+ */
+bool trace_peek(Trace_Record_t *record) {
+    if (0 == trace_count || NULL == record) {
+        return false;
+    }
+    *record = trace_ring[trace_head];
+    return true;
+}
+
+/**
+ * @brief Encode the oldest pending records into a compressed block
+ * @param[out] out Destination buffer
+ * @param[in] size Size of the destination buffer
+ * @param[in] base_us Timestamp of the first record as it should be decoded
+ * (Unix time if known, its time_us_64() value otherwise)
+ * @param[in] unix_time true if base_us is Unix time
+ * @param[out] records Number of records encoded
+ * @return Number of bytes written, 0 if nothing was encoded
+ * @note Block layout, all integers are LEB128 varints:
+ *   header: version (byte), flags (byte), record count (always two bytes),
+ *           first seq, base time (us)
+ *   record: zigzag(seq delta - 1) << 1 | lost,
+ *           zigzag(send time delta-of-delta),
+ *           zigzag(rtt delta to the previous reply), only if not lost
+ * Records are not removed, call `trace_consume()` once the block is uploaded.
+ */
+size_t trace_encode_block(uint8_t *out, size_t size, uint64_t base_us, bool unix_time,
+                        uint16_t *records) {
+    *records = 0;
+    if (0 == trace_count || size < TRACE_HEADER_MAX_BYTES + TRACE_RECORD_MAX_BYTES) {
+        return 0;
+    }
+
+    const Trace_Record_t *first = &trace_ring[trace_head];
+    size_t len = 0;
+    out[len++] = TRACE_BLOCK_VERSION;
+    out[len++] = unix_time ? TRACE_FLAG_UNIX_TIME : 0;
+    // Record count is only known at the end, keep a fixed two byte varint slot
+    size_t count_pos = len;
+    len += 2;
+    len += put_varint(out + len, first->seq);
+    len += put_varint(out + len, base_us);
+
+    uint16_t prev_seq = first->seq - 1;
+    uint64_t prev_tx_us = first->tx_us;
+    int64_t prev_delta_us = 0;
+    uint32_t prev_rtt_us = 0;
+    uint16_t count = 0;
+
+    while (count < trace_count && count < TRACE_BLOCK_RECORDS &&
+           len + TRACE_RECORD_MAX_BYTES <= size) {
+        const Trace_Record_t *rec = &trace_ring[(trace_head + count) % TRACE_RING_SIZE];
+
+        int16_t seq_delta = (int16_t)(uint16_t)(rec->seq - prev_seq);
+        int64_t delta_us = (int64_t)(rec->tx_us - prev_tx_us);
+
+        len += put_varint(out + len, (zigzag(seq_delta - 1) << 1) | (rec->lost ? 1 : 0));
+        len += put_varint(out + len, zigzag(delta_us - prev_delta_us));
+        if (!rec->lost) {
+            len += put_varint(out + len, zigzag((int64_t)rec->rtt_us - prev_rtt_us));
+            prev_rtt_us = rec->rtt_us;
+        }
+
+        prev_seq = rec->seq;
+        prev_tx_us = rec->tx_us;
+        prev_delta_us = delta_us;
+        count++;
+    }
+
+    // Non-minimal but valid LEB128: low 7 bits with continuation, then the rest
+    out[count_pos] = (uint8_t)(0x80 | (count & 0x7f));
+    out[count_pos + 1] = (uint8_t)(count >> 7);
+
+    *records = count;
+    return len;
+}
+
+/**
+ * @brief Remove the oldest records
+ * @param count Number of records to remove
+ */
+void trace_consume(uint16_t count) {
+    if (count > trace_count) {
+        count = trace_count;
+    }
+    trace_head = (trace_head + count) % TRACE_RING_SIZE;
+    trace_count -= count;
+}
+
+/**
+ * @brief Number of records overwritten before they were uploaded
+ * @return Dropped record count since boot
+ */
+uint32_t trace_dropped_count(void) {
+    return trace_dropped;
+}
+
+/**
+ * @brief Base64 encode binary data
+ * @param[in] in Input data
+ * @param[in] len Input length
+ * @param[out] out Output string
+ * @param[in] size Size of the output buffer
+ * @return String length, 0 if the output buffer is too small
+ */
+size_t trace_base64(const uint8_t *in, size_t len, char *out, size_t size) {
+    size_t out_len = 4 * ((len + 2) / 3);
+    if (out_len + 1 > size) {
+        return 0;
+    }
+
+    size_t o = 0;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t chunk = (uint32_t)in[i] << 16;
+        if (i + 1 < len) chunk |= (uint32_t)in[i + 1] << 8;
+        if (i + 2 < len) chunk |= in[i + 2];
+
+        out[o++] = base64_chars[(chunk >> 18) & 0x3f];
+        out[o++] = base64_chars[(chunk >> 12) & 0x3f];
+        out[o++] = (i + 1 < len) ? base64_chars[(chunk >> 6) & 0x3f] : '=';
+        out[o++] = (i + 2 < len) ? base64_chars[chunk & 0x3f] : '=';
+    }
+    out[o] = '\0';
+    return o;
+}
+
+/**
+ * @brief Append a record to the ring, overwriting the oldest when full
+ * @param seq ICMP sequence number
+ * @param tx_us Send time
+ * @param rtt_us Round trip time
+ * @param lost true if no reply was received
+ */
+static void trace_push(uint16_t seq, uint64_t tx_us, uint32_t rtt_us, bool lost) {
+    if (TRACE_RING_SIZE == trace_count) {
+        trace_consume(1);
+        trace_dropped++;
+    }
+
+    Trace_Record_t *rec = &trace_ring[(trace_head + trace_count) % TRACE_RING_SIZE];
+    rec->tx_us = tx_us;
+    rec->rtt_us = rtt_us;
+    rec->seq = seq;
+    rec->lost = lost;
+    trace_count++;
+}
+
+/**
+ * @brief Write an unsigned LEB128 varint
+ * @param out Destination, at least 10 bytes
+ * @param value Value to encode
+ * @return Number of bytes written
+ */
+static size_t put_varint(uint8_t *out, uint64_t value) {
+    size_t len = 0;
+    while (value >= 0x80) {
+        out[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[len++] = (uint8_t)value;
+    return len;
+}
+
+/**
+ * @brief Zig-zag map a signed value so small magnitudes encode in few bytes
+ * @param value Signed value
+ * @return Mapped unsigned value
+ */
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
@@ -2,30 +2,77 @@
 
 /* Private variables ---------------------------------------------------------*/
 static bool wifi_connected = false;
+static Wifi_Event_t event_log[WIFI_EVENT_LOG_SIZE];
+static uint16_t event_head = 0;
+static uint16_t event_count = 0;
+static uint64_t outage_start_us = 0;
+static volatile uint64_t link_down_us = 0;
+static uint8_t connect_attempt = 0;
+static Wifi_PowerMode_t power_mode = WIFI_PM_OFF;
+
+static const char *const event_names[WIFI_EVENT_COUNT] = {
+    [WIFI_EVENT_LINK_DOWN]    = "link_down",
+    [WIFI_EVENT_DRIVER_INIT]  = "driver_init",
+    [WIFI_EVENT_AUTH]         = "auth",
+    [WIFI_EVENT_ASSOC]        = "assoc",
+    [WIFI_EVENT_KEYED]        = "keyed",
+    [WIFI_EVENT_DHCP]         = "dhcp",
+    [WIFI_EVENT_CONNECT_FAIL] = "connect_fail",
+    [WIFI_EVENT_LINK_UP]      = "link_up",
+};
+
+static const char *const power_mode_names[WIFI_PM_COUNT] = {
+    [WIFI_PM_OFF]         = "off",
+    [WIFI_PM_PERFORMANCE] = "performance",
+    [WIFI_PM_AGGRESSIVE]  = "aggressive",
+    [WIFI_PM_CUSTOM]      = "custom",
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static bool wifi_connect(void);
+static void wifi_event_record(Wifi_EventType_t type, uint64_t now_us, uint64_t since_us, int status);
+static void wifi_link_callback(struct netif *netif);
 
 
 /**
  * @brief Initialize Wi-Fi in station mode and connect to router
  * @return true on success, false otherwise
  * @note `cyw43_arch_poll()` must be called periodically in the main loop for
- * this to work properly
+ * this to work properly. The connect at boot is not an outage, it records its
+ * phase events but no LINK_UP.
  */
 bool wifi_init(void) {
     DBG("Initializing Wi-Fi\n");
+
+    uint64_t start_us = time_us_64();
+    // Attempts are counted from boot or from the link loss, see wifi_is_connected()
+    if (connect_attempt < UINT8_MAX) {
+        connect_attempt++;
+    }
     
     if( cyw43_arch_init_with_country(CYW43_COUNTRY_TURKEY)) {
         DBG("Wi-Fi initialization failed!\n");
+        wifi_event_record(WIFI_EVENT_CONNECT_FAIL, time_us_64(), start_us, CYW43_LINK_FAIL);
         return false;
     }
+    wifi_event_record(WIFI_EVENT_DRIVER_INIT, time_us_64(), start_us, CYW43_LINK_DOWN);
 
-    // Disable Wi-Fi power management
-    cyw43_wifi_pm(&cyw43_state, CYW43_PERFORMANCE_PM & ~0xf);
+    // Power management is off unless a profile was selected with wifi_set_power_mode()
+    if (0 != cyw43_wifi_pm(&cyw43_state, wifi_power_mode_value(power_mode))) {
+        DBG("Failed to set power mode %s\n", wifi_power_mode_name(power_mode));
+    }
 
     // Set station mode
     cyw43_arch_enable_sta_mode();
 
+    // Stamp link loss as soon as the driver reports it
+    cyw43_arch_lwip_begin();
+    link_down_us = 0;
+    netif_set_link_callback(&cyw43_state.netif[CYW43_ITF_STA], wifi_link_callback);
+    cyw43_arch_lwip_end();
+
     DBG("Connecting to %s\n", WIFI_SSID);
-    if (0 != cyw43_arch_wifi_connect_blocking(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK)) {
+    if (!wifi_connect()) {
         DBG("Wi-Fi connection failed!\n");
         cyw43_arch_deinit();
         return false;
@@ -34,19 +81,104 @@ bool wifi_init(void) {
         DBG("Connected to %s\n", WIFI_SSID);
     }
 
+    // Whole outage from link loss until the IP address was obtained
+    if (0 != outage_start_us) {
+        uint64_t now_us = time_us_64();
+        wifi_event_record(WIFI_EVENT_LINK_UP, now_us, outage_start_us, CYW43_LINK_UP);
+        DBG("Outage lasted %llu ms, %u attempt(s)\n", (now_us - outage_start_us) / 1000, connect_attempt);
+        outage_start_us = 0;
+    }
+
     return wifi_connected;
 
 }
 
+/**
+ * @brief Connect to the access point and record each connection phase
+ * @return true once the link is up with an IP address, false otherwise
+ * @note Phases are taken from the CYW43 join state bits, which are raised by the
+ * driver as authentication, association and key exchange complete
+ */
+static bool wifi_connect(void) {
+    uint64_t phase_start_us = time_us_64();
+    uint64_t timeout = phase_start_us + WIFI_CONNECT_TIMEOUT_MS * 1000ULL;
+
+    if (0 != cyw43_arch_wifi_connect_async(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK)) {
+        wifi_event_record(WIFI_EVENT_CONNECT_FAIL, time_us_64(), phase_start_us, CYW43_LINK_FAIL);
+        return false;
+    }
+
+    static const struct {
+        uint32_t bit;
+        Wifi_EventType_t type;
+    } phases[] = {
+        { WIFI_JOIN_STATE_AUTH,  WIFI_EVENT_AUTH  },
+        { WIFI_JOIN_STATE_LINK,  WIFI_EVENT_ASSOC },
+        { WIFI_JOIN_STATE_KEYED, WIFI_EVENT_KEYED },
+    };
+    uint32_t seen = 0;
+    int status = CYW43_LINK_DOWN;
+
+    while (time_us_64() < timeout) {
+        cyw43_arch_poll();
+
+        // Status is read first so phase events carry the status they were seen with
+        uint64_t now_us = time_us_64();
+        cyw43_arch_lwip_begin();
+        status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+        cyw43_arch_lwip_end();
+
+        uint32_t join_state = cyw43_state.wifi_join_state;
+        for (size_t i = 0; i < sizeof(phases) / sizeof(phases[0]); i++) {
+            if ((join_state & phases[i].bit) && !(seen & phases[i].bit)) {
+                seen |= phases[i].bit;
+                wifi_event_record(phases[i].type, now_us, phase_start_us, status);
+                phase_start_us = now_us;
+            }
+        }
+
+        if (CYW43_LINK_UP == status) {
+            wifi_event_record(WIFI_EVENT_DHCP, now_us, phase_start_us, status);
+            return true;
+        }
+        if (status < 0) {
+            // CYW43_LINK_FAIL, CYW43_LINK_NONET or CYW43_LINK_BADAUTH
+            DBG("Wi-Fi join failed with status %d\n", status);
+            wifi_event_record(WIFI_EVENT_CONNECT_FAIL, now_us, phase_start_us, status);
+            return false;
+        }
+        sleep_ms(1);
+    }
+
+    DBG("Wi-Fi join timed out with status %d\n", status);
+    wifi_event_record(WIFI_EVENT_CONNECT_FAIL, time_us_64(), phase_start_us, status);
+    return false;
+}
+
 /**
  * @brief Check if Wi-Fi is connected
  * @return true if connected, false otherwise
+ * @note The first call that sees the link go down records the outage, starting
+ * when the driver reported the link loss
  */
 bool wifi_is_connected(void) {
     bool connected = false;
     cyw43_arch_lwip_begin();
-    connected = wifi_connected;
+    connected = wifi_connected &&
+        (CYW43_LINK_UP == cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA));
+    uint64_t down_us = link_down_us;
     cyw43_arch_lwip_end();
+
+    if (wifi_connected && !connected) {
+        // Link loss reported by the driver, otherwise this poll is the first to fail
+        if (0 == down_us) {
+            down_us = time_us_64();
+        }
+        wifi_connected = false;
+        outage_start_us = down_us;
+        connect_attempt = 0;
+        wifi_event_record(WIFI_EVENT_LINK_DOWN, down_us, down_us, CYW43_LINK_DOWN);
+    }
     return connected;
 }
 
@@ -66,4 +198,169 @@ void wifi_deinit(void) {
     DBG("De-initializing Wi-Fi\n");
     cyw43_arch_deinit();
     wifi_connected = false;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Select the Wi-Fi power management profile
+ * @param mode Power management profile
+ * @return true on success, false otherwise
+ * @note The profile is applied right away when connected and again by every
+ * `wifi_init()`, so it survives a link recovery. The association listen
+ * interval is only sent to the AP when joining, so a switch that changes the
+ * listen intervals leaves and rejoins the network. A failed rejoin is picked up
+ * by the link monitor, the profile is kept.
+ */
+bool wifi_set_power_mode(Wifi_PowerMode_t mode) {
+    if (mode >= WIFI_PM_COUNT) {
+        DBG("Invalid power mode %d\n", mode);
+        return false;
+    }
+
+    // Listen intervals are the bits above the PM mode and sleep return time
+    bool rejoin = (wifi_power_mode_value(mode) >> 12) != (wifi_power_mode_value(power_mode) >> 12);
+
+    if (wifi_connected) {
+        int err = cyw43_wifi_pm(&cyw43_state, wifi_power_mode_value(mode));
+        if (0 != err) {
+            DBG("Failed to set power mode %s: %d\n", wifi_power_mode_name(mode), err);
+            return false;
+        }
+    }
+
+    power_mode = mode;
+    DBG("Power mode %s (0x%08lx)\n", wifi_power_mode_name(mode), (unsigned long)wifi_power_mode_value(mode));
+
+    if (wifi_connected && rejoin) {
+        DBG("Rejoining %s to apply the listen intervals\n", WIFI_SSID);
+        cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+        if (!wifi_connect()) {
+            DBG("Rejoin failed\n");
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Active Wi-Fi power management profile
+ * @return Power management profile
+ */
+Wifi_PowerMode_t wifi_get_power_mode(void) {
+    return power_mode;
+}
+
+/**
+ * @brief Value passed to `cyw43_wifi_pm()` for a profile
+ * @param mode Power management profile
+ * @return Packed power management value, see `cyw43_pm_value()`
+ */
+uint32_t wifi_power_mode_value(Wifi_PowerMode_t mode) {
+    switch (mode) {
+        case WIFI_PM_PERFORMANCE:
+            return CYW43_PERFORMANCE_PM;
+        case WIFI_PM_AGGRESSIVE:
+            return CYW43_AGGRESSIVE_PM;
+        case WIFI_PM_CUSTOM:
+            return cyw43_pm_value(CYW43_PM2_POWERSAVE_MODE, WIFI_PM_CUSTOM_SLEEP_RET_MS,
+                                  WIFI_PM_CUSTOM_LI_BEACON, WIFI_PM_CUSTOM_LI_DTIM,
+                                  WIFI_PM_CUSTOM_LI_ASSOC);
+        case WIFI_PM_OFF:
+        default:
+            // Performance timings with the power save mode bits cleared
+            return CYW43_PERFORMANCE_PM & ~0xf;
+    }
+}
+
+/**
+ * @brief Power management profile name
+ * @param mode Power management profile
+ * @return Lower-case name, "unknown" for an invalid profile
+ */
+const char *wifi_power_mode_name(Wifi_PowerMode_t mode) {
+    return (mode < WIFI_PM_COUNT) ? power_mode_names[mode] : "unknown";
+}
+
+/**
+ * @brief Copy the oldest recorded connection events
+ * @param[out] events Destination array
+ * @param[in] max_events Capacity of the destination array
+ * @return Number of events copied
+ * @note Events stay in the log until `wifi_events_consume()` is called, so a
+ * failed upload can be retried
+ */
+uint16_t wifi_events_peek(Wifi_Event_t *events, uint16_t max_events) {
+    if (NULL == events) {
+        return 0;
+    }
+
+    uint16_t count = (event_count < max_events) ? event_count : max_events;
+    for (uint16_t i = 0; i < count; i++) {
+        events[i] = event_log[(event_head + i) % WIFI_EVENT_LOG_SIZE];
+    }
+    return count;
+}
+
+/**
+ * @brief Remove the oldest connection events from the log
+ * @param count Number of events to remove
+ */
+void wifi_events_consume(uint16_t count) {
+    if (count > event_count) {
+        count = event_count;
+    }
+    event_head = (event_head + count) % WIFI_EVENT_LOG_SIZE;
+    event_count -= count;
+}
+
+/**
+ * @brief Get the name of a connection event type
+ * @param type Wifi_EventType_t value
+ * @return Event name used as the InfluxDB tag value
+ */
+const char *wifi_event_name(uint8_t type) {
+    if (type >= WIFI_EVENT_COUNT) {
+        return "unknown";
+    }
+    return event_names[type];
+}
+
+/**
+ * @brief Append an event to the connection event ring buffer
+ * @param type Event type
+ * @param now_us Time the event was observed
+ * @param since_us Start of the phase that ends with this event
+ * @param status CYW43 link status
+ * @note Oldest event is overwritten when the log is full
+ */
+static void wifi_event_record(Wifi_EventType_t type, uint64_t now_us, uint64_t since_us, int status) {
+    uint64_t duration_us = now_us - since_us;
+
+    if (WIFI_EVENT_LOG_SIZE == event_count) {
+        DBG("Wi-Fi event log full, dropping oldest event\n");
+        wifi_events_consume(1);
+    }
+
+    Wifi_Event_t *event = &event_log[(event_head + event_count) % WIFI_EVENT_LOG_SIZE];
+    event->timestamp_us = now_us;
+    event->duration_us = (duration_us > UINT32_MAX) ? UINT32_MAX : (uint32_t)duration_us;
+    event->type = (uint8_t)type;
+    event->attempt = connect_attempt;
+    event->status = (int16_t)status;
+    event_count++;
+
+    DBG("Wi-Fi event %s: %lu us (attempt %u)\n", wifi_event_name(type),
+        (unsigned long)event->duration_us, connect_attempt);
+}
+
+/**
+ * @brief Station interface link callback, stamps the moment the link goes down
+ * @param netif Station interface
+ * @note Runs in lwIP context. A link that comes back before the next
+ * `wifi_is_connected()` (e.g. a power mode rejoin) clears the stamp.
+ */
+static void wifi_link_callback(struct netif *netif) {
+    if (netif_is_link_up(netif)) {
+        link_down_us = 0;
+    } else if (wifi_connected && 0 == link_down_us) {
+        link_down_us = time_us_64();
+    }
+}
@@ -0,0 +1,200 @@
+/**
+ * @brief Host-side sink for the device goodput test
+ *
+ * Listens on a TCP port (default 5201) and serves one connection at a time.
+ * The device sends a single command byte after connecting:
+ *
+ *   'U'  device uploads, the sink reads and discards until the device aborts
+ *   'D'  device downloads, the sink writes until the device aborts
+ *
+ * One summary line per connection is printed:
+ *
+ *   <peer>,<direction>,<bytes>,<seconds>,<mbit_s>
+ *
+ * See src/goodput.c for the device side.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define DEFAULT_PORT            5201
+#define IO_BUF_SIZE             (64 * 1024)
+#define CMD_UPLOAD              'U'
+#define CMD_DOWNLOAD            'D'
+// GOODPUT_DURATION_MS (5 s) plus slack, a device that vanishes mid-test ends it
+#define IO_TIMEOUT_S            10
+
+/* Private function prototypes -----------------------------------------------*/
+static int listen_on(uint16_t port);
+static void serve(int fd, const char *peer);
+static void set_timeouts(int fd);
+static double now_s(void);
+
+
+int main(int argc, char **argv) {
+    uint16_t port = DEFAULT_PORT;
+
+    if (argc > 1) {
+        long value = strtol(argv[1], NULL, 10);
+        if (value <= 0 || value > 65535) {
+            fprintf(stderr, "usage: %s [port]\n", argv[0]);
+            return 1;
+        }
+        port = (uint16_t)value;
+    }
+
+    // Writes to an aborted connection must fail with EPIPE, not kill the sink
+    signal(SIGPIPE, SIG_IGN);
+
+    int listen_fd = listen_on(port);
+    if (listen_fd < 0) {
+        return 1;
+    }
+    fprintf(stderr, "goodput_sink listening on port %u\n", port);
+    printf("peer,direction,bytes,seconds,mbit_s\n");
+    fflush(stdout);
+
+    while (true) {
+        struct sockaddr_in addr;
+        socklen_t addr_len = sizeof(addr);
+        int fd = accept(listen_fd, (struct sockaddr *)&addr, &addr_len);
+        if (fd < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            perror("accept");
+            break;
+        }
+
+        char peer[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &addr.sin_addr, peer, sizeof(peer));
+        serve(fd, peer);
+        close(fd);
+    }
+
+    close(listen_fd);
+    return 1;
+}
+
+/**
+ * @brief Open the listening socket
+ * @param port TCP port
+ * @return Socket descriptor, -1 on failure
+ */
+static int listen_on(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+        perror("bind/listen");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Serve one goodput connection and print its summary
+ * @param fd Connected socket
+ * @param peer Peer address for the summary line
+ * @note Reads and writes time out after IO_TIMEOUT_S, so a device that drops
+ * off the network without closing the connection does not block the sink
+ */
+static void serve(int fd, const char *peer) {
+    static uint8_t buf[IO_BUF_SIZE];
+    uint8_t cmd;
+
+    set_timeouts(fd);
+
+    if (recv(fd, &cmd, 1, 0) != 1) {
+        fprintf(stderr, "%s: no command byte\n", peer);
+        return;
+    }
+    if (CMD_UPLOAD != cmd && CMD_DOWNLOAD != cmd) {
+        fprintf(stderr, "%s: unknown command 0x%02x\n", peer, cmd);
+        return;
+    }
+
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = (uint8_t)i;
+    }
+
+    uint64_t bytes = 0;
+    double start = now_s();
+
+    while (true) {
+        ssize_t n;
+        if (CMD_UPLOAD == cmd) {
+            n = recv(fd, buf, sizeof(buf), 0);
+        } else {
+            n = send(fd, buf, sizeof(buf), 0);
+        }
+        if (n < 0 && EINTR == errno) {
+            continue;
+        }
+        if (n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno)) {
+            fprintf(stderr, "%s: no progress for %d s, ending test\n", peer, IO_TIMEOUT_S);
+            break;
+        }
+        if (n <= 0) {
+            // EOF, reset or EPIPE: the device ended the test
+            break;
+        }
+        bytes += (uint64_t)n;
+    }
+
+    double seconds = now_s() - start;
+    double mbit_s = (seconds > 0) ? (bytes * 8.0) / (seconds * 1e6) : 0.0;
+    // Download counts bytes handed to the kernel, queued data may never have arrived
+    printf("%s,%s,%llu,%.3f,%.2f\n", peer, (CMD_UPLOAD == cmd) ? "up" : "down",
+           (unsigned long long)bytes, seconds, mbit_s);
+    fflush(stdout);
+}
+
+/**
+ * @brief Bound blocking reads and writes and enable keepalive on a connection
+ * @param fd Connected socket
+ */
+static void set_timeouts(int fd) {
+    struct timeval tv = { .tv_sec = IO_TIMEOUT_S, .tv_usec = 0 };
+    int on = 1;
+
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) < 0) {
+        perror("setsockopt");
+    }
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+}
+
+/**
+ * @brief Monotonic time in seconds
+ * @return Seconds since an arbitrary epoch
+ */
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
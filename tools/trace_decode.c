@@ -0,0 +1,179 @@
+/**
+ * @brief Host-side decoder for wifi_trace blocks
+ *
+ * Reads base64 encoded blocks (the `block` field of the `wifi_trace` series),
+ * one per line from stdin or the command line, and prints one CSV row per probe:
+ *
+ *   seq,tx_us,rtt_us,lost
+ *
+ * tx_us is Unix time in microseconds when the device clock was synchronised,
+ * the device's time_us_64() otherwise (flagged in the per-block comment line).
+ * See trace_encode_block() in src/trace.c for the block layout.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define TRACE_BLOCK_VERSION     1
+#define TRACE_FLAG_UNIX_TIME    0x01
+#define MAX_BLOCK_BYTES         4096
+
+/* Private function prototypes -----------------------------------------------*/
+static size_t base64_decode(const char *in, uint8_t *out, size_t size);
+static bool get_varint(const uint8_t *buf, size_t len, size_t *pos, uint64_t *value);
+static int64_t unzigzag(uint64_t value);
+static bool decode_block(const char *encoded);
+
+
+int main(int argc, char **argv) {
+    static char line[4 * MAX_BLOCK_BYTES / 3 + 16];
+    bool ok = true;
+
+    printf("seq,tx_us,rtt_us,lost\n");
+
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            ok &= decode_block(argv[i]);
+        }
+        return ok ? 0 : 1;
+    }
+
+    while (fgets(line, sizeof(line), stdin)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if ('\0' == line[0]) {
+            continue;
+        }
+        ok &= decode_block(line);
+    }
+    return ok ? 0 : 1;
+}
+
+/**
+ * @brief Decode one base64 block and print its records
+ * @param encoded Base64 string, surrounding quotes are ignored
+ * @return true on success, false if the block is malformed
+ */
+static bool decode_block(const char *encoded) {
+    uint8_t block[MAX_BLOCK_BYTES];
+    size_t len = base64_decode(encoded, block, sizeof(block));
+    size_t pos = 0;
+    uint64_t count, first_seq, base_us;
+
+    if (len < 2 || TRACE_BLOCK_VERSION != block[0]) {
+        fprintf(stderr, "Unsupported or malformed block\n");
+        return false;
+    }
+    uint8_t flags = block[1];
+    pos = 2;
+    if (!get_varint(block, len, &pos, &count) ||
+        !get_varint(block, len, &pos, &first_seq) ||
+        !get_varint(block, len, &pos, &base_us)) {
+        fprintf(stderr, "Truncated block header\n");
+        return false;
+    }
+
+    printf("# block records=%llu first_seq=%llu unix_time=%d\n",
+           (unsigned long long)count, (unsigned long long)first_seq,
+           (flags & TRACE_FLAG_UNIX_TIME) ? 1 : 0);
+
+    uint16_t seq = (uint16_t)(first_seq - 1);
+    uint64_t tx_us = base_us;
+    int64_t delta_us = 0;
+    int64_t rtt_us = 0;
+
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t seq_field, dod;
+        if (!get_varint(block, len, &pos, &seq_field) || !get_varint(block, len, &pos, &dod)) {
+            fprintf(stderr, "Truncated record %llu\n", (unsigned long long)i);
+            return false;
+        }
+
+        bool lost = seq_field & 1;
+        seq = (uint16_t)(seq + unzigzag(seq_field >> 1) + 1);
+        delta_us += unzigzag(dod);
+        tx_us += delta_us;
+
+        if (lost) {
+            printf("%u,%llu,,1\n", seq, (unsigned long long)tx_us);
+            continue;
+        }
+
+        uint64_t rtt_field;
+        if (!get_varint(block, len, &pos, &rtt_field)) {
+            fprintf(stderr, "Truncated record %llu\n", (unsigned long long)i);
+            return false;
+        }
+        rtt_us += unzigzag(rtt_field);
+        printf("%u,%llu,%lld,0\n", seq, (unsigned long long)tx_us, (long long)rtt_us);
+    }
+    return true;
+}
+
+/**
+ * @brief Decode a base64 string, skipping quotes and whitespace
+ * @param in Input string
+ * @param out Output buffer
+ * @param size Size of the output buffer
+ * @return Number of decoded bytes
+ */
+static size_t base64_decode(const char *in, uint8_t *out, size_t size) {
+    uint32_t acc = 0;
+    int bits = 0;
+    size_t len = 0;
+
+    for (; *in; in++) {
+        char c = *in;
+        int v;
+        if (c >= 'A' && c <= 'Z') v = c - 'A';
+        else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') v = c - '0' + 52;
+        else if ('+' == c) v = 62;
+        else if ('/' == c) v = 63;
+        else if ('=' == c) break;
+        else continue;
+
+        acc = (acc << 6) | (uint32_t)v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            if (len < size) {
+                out[len++] = (uint8_t)(acc >> bits);
+            }
+        }
+    }
+    return len;
+}
+
+/**
+ * @brief Read an unsigned LEB128 varint
+ * @param buf Buffer
+ * @param len Buffer length
+ * @param pos Read position, advanced past the varint
+ * @param value Decoded value
+ * @return false if the buffer ends inside the varint
+ */
+static bool get_varint(const uint8_t *buf, size_t len, size_t *pos, uint64_t *value) {
+    uint64_t result = 0;
+    int shift = 0;
+
+    while (*pos < len && shift < 64) {
+        uint8_t byte = buf[(*pos)++];
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+        shift += 7;
+    }
+    return false;
+}
+
+/**
+ * @brief Undo the zig-zag mapping
+ * @param value Mapped value
+ * @return Signed value
+ */
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}